@@ -0,0 +1,29 @@
+#!/bin/sh
+# Chat benchmark: one latency room driven by chat_bench and a set of load
+# rooms driven by chat_load, all served by one server process. Client
+# tools and the server (at shutdown) append results to $BENCH_JSON.
+# Usage: bench_chat.sh <chat_dir> <workdir> [rooms] [clients_per_room]
+set -e
+CHAT=$(realpath "$1")
+WORK=$2
+ROOMS=${3:-20}
+PER_ROOM=${4:-50}
+
+mkdir -p "$WORK"
+cd "$WORK"
+rm -rf fifo_files
+"$CHAT/server" latency $(seq -f load%g 0 $((ROOMS - 1))) >/dev/null &
+SERVER=$!
+trap 'kill -INT $SERVER 2>/dev/null' EXIT INT TERM
+i=0
+until [ -p fifo_files/load$((ROOMS - 1))/server.fifo ]; do
+    i=$((i + 1))
+    [ $i -lt 50 ] || { echo "chat server did not start" >&2; exit 1; }
+    sleep 0.1
+done
+
+"$CHAT/chat_bench" latency 32 500 >/dev/null
+"$CHAT/chat_load" "$ROOMS" "$PER_ROOM" 200 >/dev/null
+kill -INT $SERVER
+wait $SERVER
+trap - EXIT INT TERM
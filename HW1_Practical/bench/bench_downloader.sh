@@ -0,0 +1,33 @@
+#!/bin/sh
+# Downloader benchmark: a local copy, then fixed and auto connection counts
+# against the local range server. Results go to $BENCH_JSON.
+# Usage: bench_downloader.sh <downloader> <workdir> [size_bytes] [port]
+set -e
+DOWNLOADER=$(realpath "$1")
+WORK=$2
+SIZE=${3:-67108864}
+PORT=${4:-8765}
+BENCH=$(dirname "$(realpath "$0")")
+
+mkdir -p "$WORK/srv" "$WORK/out"
+if [ ! -f "$WORK/srv/big.bin" ] || [ "$(stat -c %s "$WORK/srv/big.bin")" != "$SIZE" ]; then
+    python3 "$BENCH/gen_file.py" "$WORK/srv/big.bin" "$SIZE" 42
+fi
+SRC=$(realpath "$WORK/srv/big.bin")
+
+python3 "$BENCH/range_server.py" "$WORK/srv" "$PORT" 4194304 &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null' EXIT INT TERM
+i=0
+until curl -sfI "http://127.0.0.1:$PORT/big.bin" >/dev/null; do
+    kill -0 $SERVER 2>/dev/null || { echo "range server failed (port $PORT busy?)" >&2; exit 1; }
+    i=$((i + 1))
+    [ $i -lt 50 ] || { echo "range server did not start" >&2; exit 1; }
+    sleep 0.1
+done
+
+cd "$WORK/out"
+"$DOWNLOADER" "$SRC" 4 >/dev/null
+"$DOWNLOADER" "http://127.0.0.1:$PORT/big.bin" 4 >/dev/null
+"$DOWNLOADER" "http://127.0.0.1:$PORT/big.bin" auto --max-conns 16 >/dev/null
+rm -f big.bin
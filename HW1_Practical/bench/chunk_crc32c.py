@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+"""Prints a per-chunk CRC32C manifest for the downloader's --chunk-crc32c.
+
+Usage: chunk_crc32c.py <path> [block_bytes]
+
+The first line is "block <bytes>", then one hex CRC32C per block.
+"""
+import sys
+
+POLY = 0x82F63B78
+TABLE = []
+for i in range(256):
+    c = i
+    for _ in range(8):
+        c = (c >> 1) ^ POLY if c & 1 else c >> 1
+    TABLE.append(c)
+
+
+def crc32c(data):
+    crc = 0xFFFFFFFF
+    for b in data:
+        crc = TABLE[(crc ^ b) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__.strip().splitlines()[2])
+    block = int(sys.argv[2]) if len(sys.argv) == 3 else 1 << 20
+    print("block %d" % block)
+    with open(sys.argv[1], "rb") as f:
+        while True:
+            data = f.read(block)
+            if not data:
+                break
+            print("%08x" % crc32c(data))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,24 @@
+#!/usr/bin/env python3
+"""Writes <size> reproducible pseudo-random bytes to <path>.
+
+Usage: gen_file.py <path> <size> [seed]
+"""
+import random
+import sys
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit(__doc__.strip().splitlines()[2])
+    path, size = sys.argv[1], int(sys.argv[2])
+    rng = random.Random(int(sys.argv[3]) if len(sys.argv) == 4 else 42)
+    block = 1 << 20
+    with open(path, "wb") as f:
+        while size > 0:
+            n = min(block, size)
+            f.write(rng.randbytes(n))
+            size -= n
+
+
+if __name__ == "__main__":
+    main()
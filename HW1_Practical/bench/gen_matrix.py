@@ -0,0 +1,22 @@
+#!/usr/bin/env python3
+"""Prints a reproducible pooling input: "M N K L" followed by an M x N matrix.
+
+Usage: gen_matrix.py <M> <N> <K> <L> [seed]
+"""
+import random
+import sys
+
+
+def main():
+    if len(sys.argv) not in (5, 6):
+        sys.exit(__doc__.strip().splitlines()[2])
+    m, n, k, l = (int(a) for a in sys.argv[1:5])
+    rng = random.Random(int(sys.argv[5]) if len(sys.argv) == 6 else 42)
+    out = ["%d %d %d %d" % (m, n, k, l)]
+    for _ in range(m):
+        out.append(" ".join("%.3f" % rng.uniform(-1000.0, 1000.0) for _ in range(n)))
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
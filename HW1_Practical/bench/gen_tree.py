@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+"""Builds a reproducible synthetic directory tree for the finder benchmark.
+
+Usage: gen_tree.py <root> <depth> <fanout> <files_per_dir> [seed]
+
+Every directory gets <fanout> subdirectories (down to <depth> levels) and
+<files_per_dir> small files. About one directory in 16 also gets a
+"needle.txt", which is the name the benchmark searches for.
+"""
+import os
+import random
+import sys
+
+
+def build(path, depth, fanout, files, rng):
+    os.makedirs(path, exist_ok=True)
+    for i in range(files):
+        with open(os.path.join(path, "f%03d_%06x.dat" % (i, rng.getrandbits(24))), "w") as f:
+            f.write("x" * rng.randint(0, 64))
+    if rng.randrange(16) == 0:
+        open(os.path.join(path, "needle.txt"), "w").close()
+    if depth > 0:
+        for i in range(fanout):
+            build(os.path.join(path, "d%02d" % i), depth - 1, fanout, files, rng)
+
+
+def main():
+    if len(sys.argv) not in (5, 6):
+        sys.exit(__doc__.strip().splitlines()[2])
+    root, depth, fanout, files = sys.argv[1], int(sys.argv[2]), int(sys.argv[3]), int(sys.argv[4])
+    seed = int(sys.argv[5]) if len(sys.argv) == 6 else 42
+    build(root, depth, fanout, files, random.Random(seed))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Local HTTP stand-in for the downloader benchmark.
+
+Usage: range_server.py <dir> <port> [per_conn_bytes_per_s]
+
+Serves files from <dir> on 127.0.0.1 with HEAD and single-range GET
+support (Content-Length, Content-Range, 206). The optional limit caps
+each connection, so adding connections pays off the way it does against
+a real remote server.
+"""
+import http.server
+import os
+import re
+import sys
+import time
+
+
+class RangeHandler(http.server.SimpleHTTPRequestHandler):
+    rate = 0
+
+    def send_head(self):
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            return super().send_head()
+        size = os.path.getsize(path)
+        f = open(path, "rb")
+        m = re.match(r"bytes=(\d+)-(\d*)$", self.headers.get("Range", ""))
+        if m:
+            start = int(m.group(1))
+            end = min(int(m.group(2)) if m.group(2) else size - 1, size - 1)
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (start, end, size))
+            f.seek(start)
+            length = end - start + 1
+        else:
+            self.send_response(200)
+            length = size
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(length))
+        self.end_headers()
+        return LimitedReader(f, length, self.rate)
+
+    def log_message(self, *args):
+        pass
+
+
+class LimitedReader:
+    def __init__(self, f, length, rate):
+        self.f, self.left, self.rate = f, length, rate
+        self.sent, self.t0 = 0, time.monotonic()
+
+    def read(self, n=65536):
+        data = self.f.read(min(n, self.left))
+        self.left -= len(data)
+        self.sent += len(data)
+        if self.rate > 0:
+            ahead = self.sent / self.rate - (time.monotonic() - self.t0)
+            if ahead > 0:
+                time.sleep(ahead)
+        return data
+
+    def close(self):
+        self.f.close()
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit(__doc__.strip().splitlines()[2])
+    os.chdir(sys.argv[1])
+    RangeHandler.rate = int(sys.argv[3]) if len(sys.argv) == 4 else 0
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", int(sys.argv[2])), RangeHandler)
+    server.daemon_threads = True
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
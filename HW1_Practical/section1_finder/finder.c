@@ -7,6 +7,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <limits.h>
+#include <time.h>
 
 #define MAX_QUEUE    4096
 #define MAX_THREADS  8
@@ -26,6 +27,19 @@ static int should_stop = 0;
 static int active_dirs = 0;
 static char target_name[NAME_MAX + 1];
 
+/* Counters reported via BENCH_JSON. Workers count locally and fold the
+ * totals in under queue_mutex once per directory. */
+static long      stat_entries = 0;
+static long      stat_dirs    = 0;
+static long      stat_matches = 0;
+static long long stat_wait_ns = 0;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 static int queue_is_empty(void) {
     return (queue_head == queue_tail);
 }
@@ -59,8 +73,12 @@ static void *worker_thread(void *arg) {
     char dir_path[PATH_MAX];
     while (1) {
         pthread_mutex_lock(&queue_mutex);
-        while (!should_stop && queue_is_empty()) {
-            pthread_cond_wait(&queue_cv, &queue_mutex);
+        if (!should_stop && queue_is_empty()) {
+            long long t0 = now_ns();
+            while (!should_stop && queue_is_empty()) {
+                pthread_cond_wait(&queue_cv, &queue_mutex);
+            }
+            stat_wait_ns += now_ns() - t0;
         }
         if (should_stop) {
             pthread_mutex_unlock(&queue_mutex);
@@ -72,6 +90,8 @@ static void *worker_thread(void *arg) {
         }
         active_dirs += 1;
         pthread_mutex_unlock(&queue_mutex);
+        long entries = 0;
+        long matches = 0;
         DIR *d = opendir(dir_path);
         if (d != NULL) {
             struct dirent *ent;
@@ -80,6 +100,7 @@ static void *worker_thread(void *arg) {
                     strcmp(ent->d_name, "..") == 0) {
                     continue;
                 }
+                entries += 1;
                 char child[PATH_MAX];
                 int n = snprintf(child, sizeof(child), "%s/%s",
                                  dir_path, ent->d_name);
@@ -108,6 +129,7 @@ static void *worker_thread(void *arg) {
                                (unsigned long)pthread_self(),
                                abs_path);
                         fflush(stdout);
+                        matches += 1;
                     }
                 }
             }
@@ -115,6 +137,9 @@ static void *worker_thread(void *arg) {
         }
 
         pthread_mutex_lock(&queue_mutex);
+        stat_entries += entries;
+        stat_matches += matches;
+        stat_dirs    += 1;
         active_dirs -= 1;
         if (queue_is_empty() && active_dirs == 0) {
             should_stop = 1;
@@ -138,6 +163,7 @@ int main(int argc, char **argv) {
     }
     strncpy(target_name, argv[2], sizeof(target_name));
     target_name[sizeof(target_name) - 1] = '\0';
+    long long start_ns = now_ns();
     pthread_mutex_lock(&queue_mutex);
     (void)queue_push(start_dir);
     pthread_mutex_unlock(&queue_mutex);
@@ -157,5 +183,20 @@ int main(int argc, char **argv) {
         (void)pthread_join(threads[i], NULL);
     }
     printf("Search complete.\n");
+    const char *json_path = getenv("BENCH_JSON");
+    if (json_path != NULL) {
+        double elapsed = (now_ns() - start_ns) / 1e9;
+        FILE *jf = fopen(json_path, "a");
+        if (jf != NULL) {
+            fprintf(jf, "{\"tool\":\"finder\",\"threads\":%d,"
+                    "\"elapsed_s\":%.6f,\"dirs\":%ld,\"entries\":%ld,"
+                    "\"entries_per_s\":%.1f,\"matches\":%ld,"
+                    "\"queue_wait_s\":%.6f}\n",
+                    MAX_THREADS, elapsed, stat_dirs, stat_entries,
+                    elapsed > 0 ? stat_entries / elapsed : 0.0,
+                    stat_matches, stat_wait_ns / 1e9);
+            fclose(jf);
+        }
+    }
     return 0;
 }
@@ -0,0 +1,204 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+
+/* Latency benchmark for a running server: joins <num_clients> simulated
+ * users to <room>, sends <num_messages> MSG commands one at a time and
+ * measures how long each takes to reach every member. */
+
+typedef struct {
+    char name[64];
+    char fifo_path[640];
+    int  fd;
+    char buf[4096];
+    int  len;
+} bench_client_t;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+/* Reads what is available and returns how many complete "<seq> <t>"
+ * messages carrying seq were seen; their latencies go to lat_out. */
+static int drain_client(bench_client_t *c, long seq, long long *lat_out) {
+    int found = 0;
+    while (1) {
+        ssize_t n = read(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+        if (n <= 0) {
+            break;
+        }
+        c->len += (int)n;
+        c->buf[c->len] = '\0';
+        char *start = c->buf;
+        char *nl;
+        while ((nl = strchr(start, '\n')) != NULL) {
+            *nl = '\0';
+            char *colon = strstr(start, ": ");
+            long got_seq = -1;
+            long long sent = 0;
+            if (colon != NULL &&
+                sscanf(colon + 2, "%ld %lld", &got_seq, &sent) == 2 &&
+                got_seq == seq) {
+                *lat_out = now_ns() - sent;
+                found += 1;
+            }
+            start = nl + 1;
+        }
+        c->len = (int)(c->buf + c->len - start);
+        memmove(c->buf, start, c->len);
+        if (c->len == (int)sizeof(c->buf) - 1) {
+            c->len = 0;
+        }
+    }
+    return found;
+}
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <room> <num_clients> <num_messages>\n",
+                argv[0]);
+        return 1;
+    }
+    const char *room = argv[1];
+    int num_clients  = atoi(argv[2]);
+    int num_messages = atoi(argv[3]);
+    if (num_clients <= 0 || num_messages <= 0) {
+        fprintf(stderr, "Bad counts\n");
+        return 1;
+    }
+    char room_dir[512];
+    snprintf(room_dir, sizeof(room_dir), "fifo_files/%s", room);
+    char server_fifo_path[600];
+    snprintf(server_fifo_path, sizeof(server_fifo_path),
+             "%s/server.fifo", room_dir);
+    int server_fd = open(server_fifo_path, O_WRONLY);
+    if (server_fd < 0) {
+        perror("open server fifo");
+        return 1;
+    }
+    bench_client_t *clients = calloc(num_clients, sizeof(bench_client_t));
+    struct pollfd  *pfds    = calloc(num_clients, sizeof(struct pollfd));
+    long long      *lat     = calloc((size_t)num_clients * num_messages,
+                                     sizeof(long long));
+    if (clients == NULL || pfds == NULL || lat == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    int i;
+    for (i = 0; i < num_clients; i += 1) {
+        bench_client_t *c = &clients[i];
+        snprintf(c->name, sizeof(c->name), "bench%d", i);
+        snprintf(c->fifo_path, sizeof(c->fifo_path), "%s/%s.fifo",
+                 room_dir, c->name);
+        unlink(c->fifo_path);
+        if (mkfifo(c->fifo_path, 0666) != 0) {
+            perror("mkfifo");
+            return 1;
+        }
+        c->fd = open(c->fifo_path, O_RDONLY | O_NONBLOCK);
+        if (c->fd < 0) {
+            perror("open client fifo");
+            return 1;
+        }
+        pfds[i].fd = c->fd;
+        pfds[i].events = POLLIN;
+        dprintf(server_fd, "JOIN %s\n", c->name);
+    }
+    /* Let the join notices settle before timing anything. */
+    long long settle_until = now_ns() + 300000000LL;
+    while (now_ns() < settle_until) {
+        long long dummy;
+        (void)poll(pfds, num_clients, 50);
+        for (i = 0; i < num_clients; i += 1) {
+            (void)drain_client(&clients[i], -1, &dummy);
+        }
+    }
+    long samples = 0;
+    long lost = 0;
+    long long bench_start = now_ns();
+    int m;
+    for (m = 0; m < num_messages; m += 1) {
+        int *seen = calloc(num_clients, sizeof(int));
+        int remaining = num_clients;
+        dprintf(server_fd, "MSG %s %d %lld\n",
+                clients[m % num_clients].name, m, now_ns());
+        long long deadline = now_ns() + 2000000000LL;
+        while (remaining > 0 && now_ns() < deadline) {
+            if (poll(pfds, num_clients, 100) <= 0) {
+                continue;
+            }
+            for (i = 0; i < num_clients; i += 1) {
+                if (pfds[i].revents == 0 || seen[i]) {
+                    continue;
+                }
+                long long l = 0;
+                if (drain_client(&clients[i], m, &l) > 0) {
+                    seen[i] = 1;
+                    remaining -= 1;
+                    lat[samples] = l;
+                    samples += 1;
+                }
+            }
+        }
+        lost += remaining;
+        free(seen);
+    }
+    double elapsed = (now_ns() - bench_start) / 1e9;
+    for (i = 0; i < num_clients; i += 1) {
+        dprintf(server_fd, "LEAVE %s\n", clients[i].name);
+    }
+    for (i = 0; i < num_clients; i += 1) {
+        close(clients[i].fd);
+        unlink(clients[i].fifo_path);
+    }
+    close(server_fd);
+    if (samples == 0) {
+        fprintf(stderr, "No messages delivered\n");
+        return 1;
+    }
+    qsort(lat, samples, sizeof(long long), cmp_ll);
+    long long sum = 0;
+    long s;
+    for (s = 0; s < samples; s += 1) {
+        sum += lat[s];
+    }
+    printf("clients=%d messages=%d deliveries=%ld lost=%ld time=%.3fs\n",
+           num_clients, num_messages, samples, lost, elapsed);
+    printf("latency us: mean=%.1f p50=%.1f p99=%.1f max=%.1f\n",
+           sum / (double)samples / 1000.0,
+           lat[samples / 2] / 1000.0,
+           lat[(long)(samples * 0.99)] / 1000.0,
+           lat[samples - 1] / 1000.0);
+    const char *json_path = getenv("BENCH_JSON");
+    if (json_path != NULL) {
+        FILE *jf = fopen(json_path, "a");
+        if (jf != NULL) {
+            fprintf(jf, "{\"tool\":\"chat_bench\",\"clients\":%d,"
+                    "\"messages\":%d,\"deliveries\":%ld,\"lost\":%ld,"
+                    "\"mean_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,"
+                    "\"max_us\":%.3f}\n",
+                    num_clients, num_messages, samples, lost,
+                    sum / (double)samples / 1000.0,
+                    lat[samples / 2] / 1000.0,
+                    lat[(long)(samples * 0.99)] / 1000.0,
+                    lat[samples - 1] / 1000.0);
+            fclose(jf);
+        }
+    }
+    free(clients);
+    free(pfds);
+    free(lat);
+    return 0;
+}
@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+/* Load generator for a running multi-room server. Joins <clients_per_room>
+ * simulated users to each of the rooms load0..load<num_rooms-1>, keeps up
+ * to <window> messages in flight per room and reports delivered messages
+ * per second and the delivery latency distribution. Start the server
+ * with the same room names, e.g.:
+ *   ./server $(seq -f load%g 0 99) --threads 4 &
+ *   ./chat_load 100 50 200 */
+
+#define DEFAULT_WINDOW 8
+#define IDLE_TIMEOUT_NS 5000000000LL
+
+typedef struct {
+    int  room;
+    int  fd;
+    char fifo_path[640];
+    char buf[8192];
+    int  len;
+} load_client_t;
+
+typedef struct {
+    char  dir[512];
+    int   server_fd;
+    int   sent;
+    int   in_flight;
+    int  *remaining;
+} load_room_t;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+int main(int argc, char **argv) {
+    if (argc != 4 && !(argc == 6 && strcmp(argv[4], "--window") == 0)) {
+        fprintf(stderr, "Usage: %s <num_rooms> <clients_per_room> "
+                "<messages_per_room> [--window <n>]\n", argv[0]);
+        return 1;
+    }
+    int num_rooms = atoi(argv[1]);
+    int per_room  = atoi(argv[2]);
+    int messages  = atoi(argv[3]);
+    int window    = (argc == 6) ? atoi(argv[5]) : DEFAULT_WINDOW;
+    if (num_rooms <= 0 || per_room <= 0 || messages <= 0 || window <= 0) {
+        fprintf(stderr, "Bad counts\n");
+        return 1;
+    }
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    long total_clients = (long)num_rooms * per_room;
+    long expected = total_clients * messages;
+    load_room_t   *rooms   = calloc(num_rooms, sizeof(load_room_t));
+    load_client_t *clients = calloc(total_clients, sizeof(load_client_t));
+    long long     *lat     = malloc(expected * sizeof(long long));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (rooms == NULL || clients == NULL || lat == NULL || ep < 0) {
+        perror("setup");
+        return 1;
+    }
+    int r;
+    long c;
+    for (r = 0; r < num_rooms; r += 1) {
+        load_room_t *room = &rooms[r];
+        snprintf(room->dir, sizeof(room->dir), "fifo_files/load%d", r);
+        char path[600];
+        snprintf(path, sizeof(path), "%s/server.fifo", room->dir);
+        room->server_fd = open(path, O_WRONLY);
+        if (room->server_fd < 0) {
+            perror(path);
+            return 1;
+        }
+        room->remaining = malloc(messages * sizeof(int));
+        if (room->remaining == NULL) {
+            perror("malloc");
+            return 1;
+        }
+        int m;
+        for (m = 0; m < messages; m += 1) {
+            room->remaining[m] = per_room;
+        }
+    }
+    for (c = 0; c < total_clients; c += 1) {
+        load_client_t *cl = &clients[c];
+        cl->room = (int)(c / per_room);
+        snprintf(cl->fifo_path, sizeof(cl->fifo_path), "%s/u%ld.fifo",
+                 rooms[cl->room].dir, c % per_room);
+        unlink(cl->fifo_path);
+        if (mkfifo(cl->fifo_path, 0666) != 0) {
+            perror("mkfifo");
+            return 1;
+        }
+        cl->fd = open(cl->fifo_path, O_RDONLY | O_NONBLOCK);
+        if (cl->fd < 0) {
+            perror("open client fifo");
+            return 1;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = EPOLLIN;
+        ev.data.ptr = cl;
+        epoll_ctl(ep, EPOLL_CTL_ADD, cl->fd, &ev);
+        dprintf(rooms[cl->room].server_fd, "JOIN u%ld\n", c % per_room);
+    }
+    /* Drain join notices until the rooms go quiet. */
+    long long quiet_since = now_ns();
+    while (now_ns() - quiet_since < 300000000LL) {
+        struct epoll_event events[256];
+        int ne = epoll_wait(ep, events, 256, 50);
+        int e;
+        for (e = 0; e < ne; e += 1) {
+            load_client_t *cl = events[e].data.ptr;
+            char sink[8192];
+            while (read(cl->fd, sink, sizeof(sink)) > 0) {
+            }
+        }
+        if (ne > 0) {
+            quiet_since = now_ns();
+        }
+    }
+    long samples = 0;
+    long long start = now_ns();
+    long long last_progress = start;
+    int rooms_done = 0;
+    int aborted = 0;
+    while (rooms_done < num_rooms) {
+        for (r = 0; r < num_rooms; r += 1) {
+            load_room_t *room = &rooms[r];
+            while (room->in_flight < window && room->sent < messages) {
+                dprintf(room->server_fd, "MSG u%d %d %lld\n",
+                        room->sent % per_room, room->sent, now_ns());
+                room->sent += 1;
+                room->in_flight += 1;
+            }
+        }
+        struct epoll_event events[256];
+        int ne = epoll_wait(ep, events, 256, 100);
+        int e;
+        for (e = 0; e < ne; e += 1) {
+            load_client_t *cl = events[e].data.ptr;
+            load_room_t *room = &rooms[cl->room];
+            while (1) {
+                ssize_t n = read(cl->fd, cl->buf + cl->len,
+                                 sizeof(cl->buf) - 1 - cl->len);
+                if (n <= 0) {
+                    break;
+                }
+                cl->len += (int)n;
+                cl->buf[cl->len] = '\0';
+                char *line = cl->buf;
+                char *nl;
+                while ((nl = strchr(line, '\n')) != NULL) {
+                    *nl = '\0';
+                    char *colon = strstr(line, ": ");
+                    int seq = -1;
+                    long long sent = 0;
+                    if (colon != NULL &&
+                        sscanf(colon + 2, "%d %lld", &seq, &sent) == 2 &&
+                        seq >= 0 && seq < messages &&
+                        room->remaining[seq] > 0) {
+                        lat[samples] = now_ns() - sent;
+                        samples += 1;
+                        room->remaining[seq] -= 1;
+                        if (room->remaining[seq] == 0) {
+                            room->in_flight -= 1;
+                            if (room->sent == messages &&
+                                room->in_flight == 0) {
+                                rooms_done += 1;
+                            }
+                        }
+                        last_progress = now_ns();
+                    }
+                    line = nl + 1;
+                }
+                cl->len = (int)(cl->buf + cl->len - line);
+                memmove(cl->buf, line, cl->len);
+                if (cl->len == (int)sizeof(cl->buf) - 1) {
+                    cl->len = 0;
+                }
+            }
+        }
+        if (now_ns() - last_progress > IDLE_TIMEOUT_NS) {
+            fprintf(stderr, "No progress for 5s, stopping early\n");
+            aborted = 1;
+            break;
+        }
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+    /* An early stop leaves rooms short of <messages>; count what went out. */
+    long sent = 0;
+    for (r = 0; r < num_rooms; r += 1) {
+        sent += rooms[r].sent;
+    }
+    expected = (long)per_room * sent;
+    for (c = 0; c < total_clients; c += 1) {
+        dprintf(rooms[clients[c].room].server_fd, "LEAVE u%ld\n",
+                c % per_room);
+    }
+    for (c = 0; c < total_clients; c += 1) {
+        close(clients[c].fd);
+        unlink(clients[c].fifo_path);
+    }
+    for (r = 0; r < num_rooms; r += 1) {
+        close(rooms[r].server_fd);
+        free(rooms[r].remaining);
+    }
+    close(ep);
+    if (samples == 0) {
+        fprintf(stderr, "No messages delivered\n");
+        return 1;
+    }
+    qsort(lat, samples, sizeof(long long), cmp_ll);
+    printf("rooms=%d clients=%ld sent=%ld delivered=%ld lost=%ld "
+           "time=%.3fs%s\n", num_rooms, total_clients, sent, samples,
+           expected - samples, elapsed, aborted ? " (aborted)" : "");
+    printf("throughput: %.0f msgs/s sent, %.0f deliveries/s\n",
+           sent / elapsed, samples / elapsed);
+    printf("latency us: p50=%.1f p99=%.1f max=%.1f\n",
+           lat[samples / 2] / 1000.0,
+           lat[(long)(samples * 0.99)] / 1000.0,
+           lat[samples - 1] / 1000.0);
+    const char *json_path = getenv("BENCH_JSON");
+    if (json_path != NULL) {
+        FILE *jf = fopen(json_path, "a");
+        if (jf != NULL) {
+            fprintf(jf, "{\"tool\":\"chat_load\",\"rooms\":%d,"
+                    "\"clients\":%ld,\"window\":%d,\"sent\":%ld,"
+                    "\"delivered\":%ld,\"lost\":%ld,\"elapsed_s\":%.6f,"
+                    "\"msgs_per_s\":%.1f,\"deliveries_per_s\":%.1f,"
+                    "\"p50_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,"
+                    "\"aborted\":%s}\n",
+                    num_rooms, total_clients, window, sent, samples,
+                    expected - samples, elapsed, sent / elapsed,
+                    samples / elapsed, lat[samples / 2] / 1000.0,
+                    lat[(long)(samples * 0.99)] / 1000.0,
+                    lat[samples - 1] / 1000.0, aborted ? "true" : "false");
+            fclose(jf);
+        }
+    }
+    free(rooms);
+    free(clients);
+    free(lat);
+    return 0;
+}
@@ -1,7 +1,7 @@
 
 // client.c — کلاینت FIFO (ساده و خوانا، بدون یک‌خطی‌های فشرده)
 // Build: gcc -Wall -O2 -o client client.c
-// Run (WSL بهتر است در /tmp): ./client <name> <room>
+// Run (WSL بهتر است در /tmp): ./client <name> <room> [--shm]
 
 #define _GNU_SOURCE
 #include <stdio.h>
@@ -11,6 +11,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/mman.h>
+#include "shm_ring.h"
 
 static char my_name[128];
 static char my_fifo_path[512];
@@ -18,6 +22,7 @@ static char server_fifo_path[512];
 
 static int my_fifo_fd = -1;
 static int server_fifo_fd = -1;
+static shm_ring_t *ring = NULL;
 
 static void cleanup(void) {
     if (my_fifo_fd >= 0) {
@@ -28,7 +33,18 @@ static void cleanup(void) {
         close(server_fifo_fd);
         server_fifo_fd = -1;
     }
-    unlink(my_fifo_path);
+    if (my_fifo_path[0] != '\0') {
+        unlink(my_fifo_path);
+    }
+}
+
+// خوانندهٔ فرزند فقط وقتی خارج می‌شود که سرور ما را بیرون کرده یا بسته است
+static void handle_sigchld(int sig) {
+    (void)sig;
+    static const char note[] = "[client] disconnected by server\n";
+    (void)write(STDERR_FILENO, note, sizeof(note) - 1);
+    cleanup();
+    _exit(0);
 }
 
 static void handle_sigint(int sig) {
@@ -41,8 +57,9 @@ static void handle_sigint(int sig) {
 }
 
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <name> <room>\n", argv[0]);
+    int use_shm = (argc == 4 && strcmp(argv[3], "--shm") == 0);
+    if (argc != 3 && !use_shm) {
+        fprintf(stderr, "Usage: %s <name> <room> [--shm]\n", argv[0]);
         return 1;
     }
     snprintf(my_name, sizeof(my_name), "%s", argv[1]);
@@ -52,17 +69,38 @@ int main(int argc, char **argv) {
     snprintf(room_dir, sizeof(room_dir), "fifo_files/%s", room);
     mkdir("fifo_files", 0777);
     mkdir(room_dir, 0777);
-    snprintf(my_fifo_path, sizeof(my_fifo_path),
-             "%s/%s.fifo", room_dir, my_name);
-    unlink(my_fifo_path);
-    if (mkfifo(my_fifo_path, 0666) != 0) {
-        perror("mkfifo (client)");
-        return 1;
+    uint64_t cursor = 0;
+    if (use_shm) {
+        // پیام‌ها از حلقهٔ حافظهٔ مشترک سرور خوانده می‌شوند، نه از FIFO
+        char ring_name[300];
+        shm_ring_name(ring_name, sizeof(ring_name), room);
+        int shm_fd = shm_open(ring_name, O_RDWR, 0);
+        if (shm_fd < 0) {
+            perror("shm_open (server started without --shm?)");
+            return 1;
+        }
+        ring = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, shm_fd, 0);
+        close(shm_fd);
+        if (ring == MAP_FAILED || ring->magic != SHM_RING_MAGIC) {
+            fprintf(stderr, "bad shared-memory ring\n");
+            return 1;
+        }
+        cursor = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
     }
-    my_fifo_fd = open(my_fifo_path, O_RDONLY | O_NONBLOCK);
-    if (my_fifo_fd < 0) {
-        perror("open my fifo");
-        return 1;
+    else {
+        snprintf(my_fifo_path, sizeof(my_fifo_path),
+                 "%s/%s.fifo", room_dir, my_name);
+        unlink(my_fifo_path);
+        if (mkfifo(my_fifo_path, 0666) != 0) {
+            perror("mkfifo (client)");
+            return 1;
+        }
+        my_fifo_fd = open(my_fifo_path, O_RDONLY | O_NONBLOCK);
+        if (my_fifo_fd < 0) {
+            perror("open my fifo");
+            return 1;
+        }
     }
     snprintf(server_fifo_path, sizeof(server_fifo_path),
              "%s/server.fifo", room_dir);
@@ -72,15 +110,50 @@ int main(int argc, char **argv) {
         cleanup();
         return 1;
     }
-    dprintf(server_fifo_fd, "JOIN %s\n", my_name);
+    // در حالت shm سرور هیچ FIFOای برای ما ندارد؛ pid را می‌فرستیم تا
+    // اگر بدون LEAVE مردیم، سرور از طریق pidfd باخبر شود
+    if (use_shm) {
+        dprintf(server_fifo_fd, "JOIN %s shm %d\n", my_name, (int)getpid());
+    }
+    else {
+        dprintf(server_fifo_fd, "JOIN %s\n", my_name);
+    }
     signal(SIGINT, handle_sigint);
+    signal(SIGCHLD, handle_sigchld);
     pid_t child = fork();
     if (child == 0) {
+        // بدون polling: تا رسیدن داده روی FIFO بلاک می‌شویم
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (ring != NULL) {
+            char msg[SHM_SLOT_DATA];
+            uint64_t lost = 0;
+            uint64_t reported = 0;
+            int n;
+            while ((n = shm_ring_read(ring, &cursor, msg, &lost)) >= 0) {
+                if (lost != reported) {
+                    printf("[client] missed %llu messages\n",
+                           (unsigned long long)(lost - reported));
+                    reported = lost;
+                }
+                fwrite(msg, 1, n, stdout);
+                fflush(stdout);
+            }
+            _exit(0);
+        }
         char buf[1024];
+        struct pollfd pfd;
+        pfd.fd = my_fifo_fd;
+        pfd.events = POLLIN;
         while (1) {
+            if (poll(&pfd, 1, -1) < 0) {
+                continue;
+            }
             ssize_t n = read(my_fifo_fd, buf, sizeof(buf) - 1);
-            if (n <= 0) {
-                usleep(50000);
+            if (n == 0) {
+                // سرور FIFO را بست
+                _exit(0);
+            }
+            if (n < 0) {
                 continue;
             }
 
@@ -104,6 +177,7 @@ int main(int argc, char **argv) {
         }
         dprintf(server_fifo_fd, "MSG %s %s\n", my_name, line);
     }
+    signal(SIGCHLD, SIG_DFL);
     dprintf(server_fifo_fd, "LEAVE %s\n", my_name);
     cleanup();
     return 0;
@@ -7,163 +7,782 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include "shm_ring.h"
 
-#define MAX_USERS 64
+#define MAX_SHARDS        64
+#define MAX_EVENTS        256
+#define LAT_BUCKETS       64
+#define DEFAULT_QUEUE_MAX 256
 
+/* epoll tags: rooms and users both start with an int tag. */
+#define TAG_ROOM 1
+#define TAG_USER 2
+
+/* A formatted message ("text\n"), shared by every queue that holds it.
+ * Messages never leave the shard that created them, so refs is plain. */
 typedef struct {
-    char name[128];
-    char fifo_path[512];
-    int  fifo_fd;
-    int  used;
+    int  refs;
+    int  len;
+    char data[];
+} msg_t;
+
+struct room;
+struct shard;
+
+typedef struct user {
+    int           tag;
+    char          name[128];
+    char          fifo_path[640];
+    int           fifo_fd;
+    int           pid_fd;       /* shm members: readable once they exit */
+    int           used;
+    struct room  *room;
+    int           slot;
+    unsigned      hash;
+    struct user  *hnext;
+    struct user  *dead_next;
+    msg_t       **queue;
+    int           q_head;
+    int           q_count;
+    int           q_off;
+    int           want_out;
+    long          dropped;
 } user_t;
-static user_t users[MAX_USERS];
-static char server_fifo_path[512];
-static int  server_fd_read  = -1;
-static int  server_fd_write = -1;
-static int  running = 1;
+
+typedef struct room {
+    int           tag;
+    char          name[256];
+    char          dir[512];
+    char          fifo_path[600];
+    int           fd_read;
+    int           fd_write;
+    char          buffer[4096];
+    size_t        pending;
+    user_t      **members;
+    int           count;
+    int           cap;
+    shm_ring_t   *ring;
+    char          ring_name[300];
+    struct shard *shard;
+} room_t;
+
+/* Each shard thread owns a set of rooms outright: their FIFOs, members
+ * and registry entries are never touched by another thread. */
+typedef struct shard {
+    pthread_t thread;
+    int       epoll_fd;
+    user_t  **buckets;
+    unsigned  nbuckets;
+    unsigned  nusers;
+    user_t   *dead;
+    /* MSG handling time (read to fan-out done), log2(ns) buckets. */
+    long      lat_hist[LAT_BUCKETS];
+    long      lat_count;
+    long long lat_sum_ns;
+    long long lat_max_ns;
+} shard_t;
+
+static room_t  *rooms = NULL;
+static int      num_rooms = 0;
+static shard_t  shards[MAX_SHARDS];
+static int      num_shards = 0;
+static int      stop_fd = -1;
+static int      queue_max = DEFAULT_QUEUE_MAX;
+static int      kick_slow = 0;
 
 static void handle_sigint(int sig) {
     (void)sig;
-    running = 0;
+    uint64_t one = 1;
+    if (stop_fd >= 0) {
+        (void)write(stop_fd, &one, sizeof(one));
+    }
 }
-static int find_user_index(const char *name) {
-    int i;
-    for (i = 0; i < MAX_USERS; i += 1) {
-        if (users[i].used == 1) {
-            if (strcmp(users[i].name, name) == 0) {
-                return i;
-            }
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+static void record_latency(shard_t *sh, long long ns) {
+    int b = 0;
+    while (b < LAT_BUCKETS - 1 && (1LL << (b + 1)) <= ns) {
+        b += 1;
+    }
+    sh->lat_hist[b] += 1;
+    sh->lat_count  += 1;
+    sh->lat_sum_ns += ns;
+    if (ns > sh->lat_max_ns) {
+        sh->lat_max_ns = ns;
+    }
+}
+static void msg_release(msg_t *m) {
+    m->refs -= 1;
+    if (m->refs == 0) {
+        free(m);
+    }
+}
+/* FNV-1a over the member name, seeded with the room's address. */
+static unsigned user_hash(const room_t *room, const char *name) {
+    unsigned h = 2166136261u ^ (unsigned)((uintptr_t)room >> 4);
+    while (*name != '\0') {
+        h ^= (unsigned char)*name;
+        h *= 16777619u;
+        name += 1;
+    }
+    return h;
+}
+static user_t *find_user(room_t *room, const char *name) {
+    shard_t *sh = room->shard;
+    unsigned h = user_hash(room, name);
+    user_t *u = sh->buckets[h & (sh->nbuckets - 1)];
+    while (u != NULL) {
+        if (u->hash == h && u->room == room && strcmp(u->name, name) == 0) {
+            return u;
         }
+        u = u->hnext;
     }
-    return -1;
+    return NULL;
 }
-static int add_user(const char *name, const char *room_dir) {
-    int i;
-    for (i = 0; i < MAX_USERS; i += 1) {
-        if (users[i].used == 0) {
-            snprintf(users[i].name, sizeof(users[i].name), "%s", name);
-            snprintf(users[i].fifo_path, sizeof(users[i].fifo_path),
-                     "%s/%s.fifo", room_dir, name);
-            users[i].fifo_fd = open(users[i].fifo_path, O_WRONLY);
-            if (users[i].fifo_fd < 0) {
-                return -1;
+static int registry_insert(shard_t *sh, user_t *u) {
+    if (sh->nusers + 1 > sh->nbuckets) {
+        unsigned n = sh->nbuckets * 2;
+        user_t **b = calloc(n, sizeof(user_t *));
+        if (b == NULL) {
+            return -1;
+        }
+        unsigned i;
+        for (i = 0; i < sh->nbuckets; i += 1) {
+            user_t *v = sh->buckets[i];
+            while (v != NULL) {
+                user_t *next = v->hnext;
+                v->hnext = b[v->hash & (n - 1)];
+                b[v->hash & (n - 1)] = v;
+                v = next;
             }
-            users[i].used = 1;
-            return i;
         }
+        free(sh->buckets);
+        sh->buckets  = b;
+        sh->nbuckets = n;
+    }
+    user_t **head = &sh->buckets[u->hash & (sh->nbuckets - 1)];
+    u->hnext = *head;
+    *head = u;
+    sh->nusers += 1;
+    return 0;
+}
+static void registry_remove(shard_t *sh, user_t *u) {
+    user_t **p = &sh->buckets[u->hash & (sh->nbuckets - 1)];
+    while (*p != NULL) {
+        if (*p == u) {
+            *p = u->hnext;
+            sh->nusers -= 1;
+            return;
+        }
+        p = &(*p)->hnext;
+    }
+}
+static void set_want_out(user_t *u, int on) {
+    if (u->want_out == on) {
+        return;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = on ? EPOLLOUT : 0;
+    ev.data.ptr = u;
+    epoll_ctl(u->room->shard->epoll_fd, EPOLL_CTL_MOD, u->fifo_fd, &ev);
+    u->want_out = on;
+}
+static void free_user(user_t *u) {
+    if (u->fifo_fd >= 0) {
+        close(u->fifo_fd);
+    }
+    if (u->pid_fd >= 0) {
+        close(u->pid_fd);
+    }
+    free(u->queue);
+    free(u);
+}
+/* Members that joined with "shm" read the ring and get no FIFO. Their
+ * pid, when given, is watched through a pidfd so a client that dies
+ * without LEAVE is still removed. */
+static user_t *add_user(room_t *room, const char *name, int via_shm,
+                        int pid) {
+    user_t *u = calloc(1, sizeof(user_t));
+    if (u == NULL) {
+        return NULL;
+    }
+    u->tag     = TAG_USER;
+    u->room    = room;
+    u->fifo_fd = -1;
+    u->pid_fd  = -1;
+    u->hash    = user_hash(room, name);
+    snprintf(u->name, sizeof(u->name), "%s", name);
+    if (via_shm && pid > 0) {
+        u->pid_fd = (int)syscall(SYS_pidfd_open, pid, 0);
+        if (u->pid_fd < 0 && errno == ESRCH) {
+            /* Gone before its JOIN was read. */
+            free_user(u);
+            return NULL;
+        }
+    }
+    if (!via_shm) {
+        snprintf(u->fifo_path, sizeof(u->fifo_path),
+                 "%s/%s.fifo", room->dir, name);
+        u->fifo_fd = open(u->fifo_path, O_WRONLY | O_NONBLOCK);
+        u->queue   = calloc(queue_max, sizeof(msg_t *));
+        if (u->fifo_fd < 0 || u->queue == NULL) {
+            free_user(u);
+            return NULL;
+        }
+    }
+    if (room->count == room->cap) {
+        int cap = room->cap ? room->cap * 2 : 16;
+        user_t **m = realloc(room->members, cap * sizeof(user_t *));
+        if (m == NULL) {
+            free_user(u);
+            return NULL;
+        }
+        room->members = m;
+        room->cap = cap;
+    }
+    if (registry_insert(room->shard, u) != 0) {
+        free_user(u);
+        return NULL;
+    }
+    if (u->fifo_fd >= 0) {
+        /* Registered with no events so EPOLLERR reports a vanished reader. */
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.data.ptr = u;
+        epoll_ctl(room->shard->epoll_fd, EPOLL_CTL_ADD, u->fifo_fd, &ev);
+    }
+    if (u->pid_fd >= 0) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = EPOLLIN;
+        ev.data.ptr = u;
+        epoll_ctl(room->shard->epoll_fd, EPOLL_CTL_ADD, u->pid_fd, &ev);
+    }
+    u->slot = room->count;
+    room->members[room->count] = u;
+    room->count += 1;
+    u->used = 1;
+    return u;
+}
+/* Unlinks u everywhere; the memory is freed after the current epoll
+ * batch, since later events in the batch may still point at it. */
+static void remove_user(user_t *u) {
+    room_t  *room = u->room;
+    shard_t *sh   = room->shard;
+    if (u->fifo_fd >= 0) {
+        epoll_ctl(sh->epoll_fd, EPOLL_CTL_DEL, u->fifo_fd, NULL);
+        close(u->fifo_fd);
+        u->fifo_fd = -1;
+    }
+    if (u->pid_fd >= 0) {
+        epoll_ctl(sh->epoll_fd, EPOLL_CTL_DEL, u->pid_fd, NULL);
+        close(u->pid_fd);
+        u->pid_fd = -1;
+    }
+    while (u->q_count > 0) {
+        msg_release(u->queue[u->q_head]);
+        u->q_head = (u->q_head + 1) % queue_max;
+        u->q_count -= 1;
+    }
+    registry_remove(sh, u);
+    room->count -= 1;
+    room->members[u->slot] = room->members[room->count];
+    room->members[u->slot]->slot = u->slot;
+    u->used = 0;
+    u->dead_next = sh->dead;
+    sh->dead = u;
+}
+static void reap_dead(shard_t *sh) {
+    while (sh->dead != NULL) {
+        user_t *u = sh->dead;
+        sh->dead = u->dead_next;
+        free_user(u);
     }
-    return -1;
 }
-static void remove_user(const char *name) {
-    int idx = find_user_index(name);
-    if (idx >= 0) {
-        if (users[idx].fifo_fd >= 0) {
-            close(users[idx].fifo_fd);
+/* Writes queued messages until the queue drains or the pipe fills.
+ * Returns -1 if the reader is gone. */
+static int flush_user(user_t *u) {
+    while (u->q_count > 0) {
+        msg_t *m = u->queue[u->q_head];
+        ssize_t w = write(u->fifo_fd, m->data + u->q_off, m->len - u->q_off);
+        if (w < 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+            return -1;
         }
-        users[idx].fifo_fd = -1;
-        users[idx].used = 0;
+        u->q_off += (int)w;
+        if (u->q_off < m->len) {
+            continue;
+        }
+        msg_release(m);
+        u->q_off  = 0;
+        u->q_head = (u->q_head + 1) % queue_max;
+        u->q_count -= 1;
     }
+    set_want_out(u, u->q_count > 0);
+    return 0;
 }
-static void broadcast_message(const char *msg) {
+/* Formats msg once and hands the same buffer to every member; members
+ * whose pipe is full get it queued instead of stalling the room. Members
+ * dropped on the way (reader gone, or kicked as too slow) are announced
+ * as having left once the loop is done. */
+static void broadcast_message(room_t *room, const char *msg) {
+    user_t *dead_before = room->shard->dead;
+    size_t len = strlen(msg);
+    msg_t *m = malloc(sizeof(msg_t) + len + 1);
+    if (m == NULL) {
+        return;
+    }
+    m->refs = 1;
+    m->len  = (int)len + 1;
+    memcpy(m->data, msg, len);
+    m->data[len] = '\n';
+    if (room->ring != NULL) {
+        shm_ring_publish(room->ring, m->data, m->len);
+    }
+    /* Backwards, so a removal (swap with the last member) is safe. */
     int i;
-    for (i = 0; i < MAX_USERS; i += 1) {
-        if (users[i].used == 1 && users[i].fifo_fd >= 0) {
-            dprintf(users[i].fifo_fd, "%s\n", msg);
+    for (i = room->count - 1; i >= 0; i -= 1) {
+        user_t *u = room->members[i];
+        if (u->fifo_fd < 0) {
+            continue;
+        }
+        if (u->q_count == queue_max) {
+            if (kick_slow) {
+                printf("[server] disconnecting slow reader %s from '%s'\n",
+                       u->name, room->name);
+                fflush(stdout);
+                remove_user(u);
+            }
+            else {
+                u->dropped += 1;
+            }
+            continue;
         }
+        m->refs += 1;
+        u->queue[(u->q_head + u->q_count) % queue_max] = m;
+        u->q_count += 1;
+        if (flush_user(u) < 0) {
+            remove_user(u);
+        }
+    }
+    msg_release(m);
+    /* remove_user pushes onto the shard's dead list, which stays valid
+     * until the end of the epoll batch. */
+    user_t *gone = room->shard->dead;
+    while (gone != dead_before) {
+        char left[256];
+        snprintf(left, sizeof(left), "[server] %s left.", gone->name);
+        broadcast_message(room, left);
+        gone = gone->dead_next;
     }
 }
-int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <room>\n", argv[0]);
-        return 1;
+static void handle_command(room_t *room, char *line) {
+    if (strncmp(line, "JOIN ", 5) == 0) {
+        char name[128];
+        char mode[16] = "";
+        int pid = 0;
+        int ok = sscanf(line + 5, "%127s %15s %d", name, mode, &pid);
+        int via_shm = (strcmp(mode, "shm") == 0);
+        if (ok >= 1 && (!via_shm || room->ring != NULL)) {
+            user_t *old = find_user(room, name);
+            if (old != NULL && old->fifo_fd < 0 && old->pid_fd < 0) {
+                /* An unwatched shm member cannot be told apart from one
+                 * that died without LEAVE; the new JOIN takes the name. */
+                remove_user(old);
+                old = NULL;
+            }
+            if (old == NULL) {
+                if (add_user(room, name, via_shm, pid) != NULL) {
+                    char msg[256];
+                    snprintf(msg, sizeof(msg),
+                             "[server] %s joined.", name);
+                    broadcast_message(room, msg);
+                }
+            }
+        }
     }
-    char room[256];
-    snprintf(room, sizeof(room), "%s", argv[1]);
-    char room_dir[512];
-    snprintf(room_dir, sizeof(room_dir), "fifo_files/%s", room);
-    mkdir("fifo_files", 0777);
-    mkdir(room_dir, 0777);
-    snprintf(server_fifo_path, sizeof(server_fifo_path),
-             "%s/server.fifo", room_dir);
-    unlink(server_fifo_path);
-    if (mkfifo(server_fifo_path, 0666) != 0 && errno != EEXIST) {
-        perror("mkfifo(server)");
-        return 1;
+    else if (strncmp(line, "LEAVE ", 6) == 0) {
+        char name[128];
+        int ok = sscanf(line + 6, "%127s", name);
+        /* A member already dropped (reader gone, pidfd fired) has been
+         * announced; only a live member's LEAVE gets a notice. */
+        user_t *u = (ok == 1) ? find_user(room, name) : NULL;
+        if (u != NULL) {
+            char msg[256];
+            snprintf(msg, sizeof(msg),
+                     "[server] %s left.", u->name);
+            remove_user(u);
+            broadcast_message(room, msg);
+        }
     }
-    signal(SIGINT, handle_sigint);
-    server_fd_read = open(server_fifo_path, O_RDONLY | O_NONBLOCK);
-    if (server_fd_read < 0) {
-        perror("open server fifo for read");
-        return 1;
+    else if (strncmp(line, "MSG ", 4) == 0) {
+        char name[128];
+        int consumed = 0;
+        int ok = sscanf(line + 4, "%127s %n", name, &consumed);
+        if (ok == 1) {
+            const char *text = line + 4 + consumed;
+            char msg[1600];
+            snprintf(msg, sizeof(msg), "%s: %s", name, text);
+            broadcast_message(room, msg);
+        }
     }
-    server_fd_write = open(server_fifo_path, O_WRONLY);
-    printf("[server] room '%s' ready. FIFO: %s\n", room, server_fifo_path);
-    fflush(stdout);
-    char buffer[2048];
-    while (running) {
-        ssize_t n = read(server_fd_read, buffer, sizeof(buffer) - 1);
+}
+/* Commands may straddle read() boundaries; the tail of an unfinished
+ * line is carried over to the next read. */
+static void read_commands(room_t *room) {
+    while (1) {
+        ssize_t n = read(room->fd_read, room->buffer + room->pending,
+                         sizeof(room->buffer) - 1 - room->pending);
         if (n <= 0) {
-            usleep(50000);
+            break;
+        }
+        long long t_read = now_ns();
+        n += room->pending;
+        room->buffer[n] = '\0';
+        char *tail = strrchr(room->buffer, '\n');
+        if (tail == NULL) {
+            room->pending = (size_t)n;
+            if (room->pending == sizeof(room->buffer) - 1) {
+                room->pending = 0;
+            }
             continue;
         }
-        buffer[n] = '\0';
+        *tail = '\0';
         char *save = NULL;
-        char *line = strtok_r(buffer, "\n", &save);
+        char *line = strtok_r(room->buffer, "\n", &save);
         while (line != NULL) {
-            if (strncmp(line, "JOIN ", 5) == 0) {
-                char name[128];
-                int ok = sscanf(line + 5, "%127s", name);
-                if (ok == 1) {
-                    if (find_user_index(name) < 0) {
-                        int idx = add_user(name, room_dir);
-                        if (idx >= 0) {
-                            char msg[256];
-                            snprintf(msg, sizeof(msg),
-                                     "[server] %s joined.", name);
-                            broadcast_message(msg);
-                        }
-                    }
-                }
+            int is_msg = (strncmp(line, "MSG ", 4) == 0);
+            handle_command(room, line);
+            if (is_msg) {
+                record_latency(room->shard, now_ns() - t_read);
             }
-            else if (strncmp(line, "LEAVE ", 6) == 0) {
-                char name[128];
-                int ok = sscanf(line + 6, "%127s", name);
-                if (ok == 1) {
-                    char msg[256];
-                    snprintf(msg, sizeof(msg),
-                             "[server] %s left.", name);
-                    broadcast_message(msg);
-                    remove_user(name);
-                }
+            line = strtok_r(NULL, "\n", &save);
+        }
+        room->pending = (size_t)(room->buffer + n - (tail + 1));
+        memmove(room->buffer, tail + 1, room->pending);
+    }
+}
+static void *shard_main(void *arg) {
+    shard_t *sh = (shard_t *)arg;
+    int stopping = 0;
+    while (!stopping) {
+        struct epoll_event events[MAX_EVENTS];
+        int ne = epoll_wait(sh->epoll_fd, events, MAX_EVENTS, -1);
+        if (ne < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        int e;
+        for (e = 0; e < ne; e += 1) {
+            void *tag = events[e].data.ptr;
+            if (tag == &stop_fd) {
+                stopping = 1;
+                continue;
+            }
+            if (*(int *)tag == TAG_ROOM) {
+                read_commands((room_t *)tag);
+                continue;
+            }
+            user_t *u = (user_t *)tag;
+            if (u->used == 0) {
+                continue;
+            }
+            if (u->pid_fd >= 0 || (events[e].events & EPOLLERR) ||
+                flush_user(u) < 0) {
+                /* Reader went away without sending LEAVE; for shm members
+                 * the only event is their pidfd reporting an exit. */
+                char msg[256];
+                room_t *room = u->room;
+                snprintf(msg, sizeof(msg), "[server] %s left.", u->name);
+                remove_user(u);
+                broadcast_message(room, msg);
+            }
+        }
+        reap_dead(sh);
+    }
+    int r;
+    for (r = 0; r < num_rooms; r += 1) {
+        room_t *room = &rooms[r];
+        if (room->shard != sh) {
+            continue;
+        }
+        broadcast_message(room, "[server] shutting down...");
+        while (room->count > 0) {
+            user_t *u = room->members[room->count - 1];
+            if (u->dropped > 0) {
+                printf("[server] %s missed %ld messages (queue full)\n",
+                       u->name, u->dropped);
+            }
+            remove_user(u);
+        }
+    }
+    reap_dead(sh);
+    return NULL;
+}
+/* Upper bound of the histogram bucket holding quantile q, in ns; the
+ * caller clamps it to the observed maximum. */
+static long long hist_quantile(const long *hist, long count, double q) {
+    long want = (long)(count * q);
+    long seen = 0;
+    int b;
+    for (b = 0; b < LAT_BUCKETS; b += 1) {
+        seen += hist[b];
+        if (seen > want) {
+            return 1LL << (b + 1);
+        }
+    }
+    return 1LL << (LAT_BUCKETS - 1);
+}
+static void write_bench_json(void) {
+    const char *json_path = getenv("BENCH_JSON");
+    if (json_path == NULL) {
+        return;
+    }
+    long hist[LAT_BUCKETS];
+    long count = 0;
+    long long sum = 0;
+    long long max = 0;
+    int i;
+    int b;
+    memset(hist, 0, sizeof(hist));
+    for (i = 0; i < num_shards; i += 1) {
+        for (b = 0; b < LAT_BUCKETS; b += 1) {
+            hist[b] += shards[i].lat_hist[b];
+        }
+        count += shards[i].lat_count;
+        sum   += shards[i].lat_sum_ns;
+        if (shards[i].lat_max_ns > max) {
+            max = shards[i].lat_max_ns;
+        }
+    }
+    long long p50 = (count > 0) ? hist_quantile(hist, count, 0.50) : 0;
+    long long p99 = (count > 0) ? hist_quantile(hist, count, 0.99) : 0;
+    p50 = (p50 > max) ? max : p50;
+    p99 = (p99 > max) ? max : p99;
+    FILE *jf = fopen(json_path, "a");
+    if (jf == NULL) {
+        return;
+    }
+    fprintf(jf, "{\"tool\":\"chat_server\",\"rooms\":%d,\"threads\":%d,"
+            "\"messages\":%ld,\"mean_us\":%.3f,\"p50_us_le\":%.3f,"
+            "\"p99_us_le\":%.3f,\"max_us\":%.3f}\n",
+            num_rooms, num_shards, count,
+            count > 0 ? sum / (double)count / 1000.0 : 0.0,
+            p50 / 1000.0, p99 / 1000.0,
+            max / 1000.0);
+    fclose(jf);
+}
+static int open_room(room_t *room, int use_shm) {
+    room->tag      = TAG_ROOM;
+    room->fd_read  = -1;
+    room->fd_write = -1;
+    snprintf(room->dir, sizeof(room->dir), "fifo_files/%s", room->name);
+    mkdir(room->dir, 0777);
+    snprintf(room->fifo_path, sizeof(room->fifo_path),
+             "%s/server.fifo", room->dir);
+    unlink(room->fifo_path);
+    if (mkfifo(room->fifo_path, 0666) != 0 && errno != EEXIST) {
+        perror("mkfifo(server)");
+        return -1;
+    }
+    if (use_shm) {
+        shm_ring_name(room->ring_name, sizeof(room->ring_name), room->name);
+        shm_unlink(room->ring_name);
+        int shm_fd = shm_open(room->ring_name, O_CREAT | O_EXCL | O_RDWR,
+                              0666);
+        if (shm_fd < 0 || ftruncate(shm_fd, sizeof(shm_ring_t)) != 0) {
+            perror("shm_open");
+            return -1;
+        }
+        room->ring = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE,
+                          MAP_SHARED, shm_fd, 0);
+        close(shm_fd);
+        if (room->ring == MAP_FAILED) {
+            room->ring = NULL;
+            perror("mmap");
+            return -1;
+        }
+        room->ring->magic = SHM_RING_MAGIC;
+    }
+    room->fd_read = open(room->fifo_path, O_RDONLY | O_NONBLOCK);
+    if (room->fd_read < 0) {
+        perror("open server fifo for read");
+        return -1;
+    }
+    room->fd_write = open(room->fifo_path, O_WRONLY);
+    return 0;
+}
+static void close_room(room_t *room) {
+    if (room->fd_read >= 0) {
+        close(room->fd_read);
+    }
+    if (room->fd_write >= 0) {
+        close(room->fd_write);
+    }
+    if (room->ring != NULL) {
+        __atomic_store_n(&room->ring->closed, 1, __ATOMIC_RELEASE);
+        shm_ring_wake(room->ring);
+        munmap(room->ring, sizeof(shm_ring_t));
+        shm_unlink(room->ring_name);
+    }
+    free(room->members);
+    unlink(room->fifo_path);
+}
+int main(int argc, char **argv) {
+    int bad_args = 0;
+    int use_shm = 0;
+    int a;
+    rooms = calloc(argc, sizeof(room_t));
+    if (rooms == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    for (a = 1; a < argc && !bad_args; a += 1) {
+        if (strcmp(argv[a], "--shm") == 0) {
+            use_shm = 1;
+        }
+        else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            a += 1;
+            num_shards = atoi(argv[a]);
+            bad_args = (num_shards <= 0 || num_shards > MAX_SHARDS);
+        }
+        else if (strcmp(argv[a], "--queue-max") == 0 && a + 1 < argc) {
+            a += 1;
+            queue_max = atoi(argv[a]);
+            bad_args = (queue_max <= 0);
+        }
+        else if (strcmp(argv[a], "--slow-policy") == 0 && a + 1 < argc) {
+            a += 1;
+            if (strcmp(argv[a], "drop") == 0) {
+                kick_slow = 0;
+            }
+            else if (strcmp(argv[a], "disconnect") == 0) {
+                kick_slow = 1;
+            }
+            else {
+                bad_args = 1;
             }
-            else if (strncmp(line, "MSG ", 4) == 0) {
-                char name[128];
-                int consumed = 0;
-                int ok = sscanf(line + 4, "%127s %n", name, &consumed);
-                if (ok == 1) {
-                    const char *text = line + 4 + consumed;
-                    char msg[1600];
-                    snprintf(msg, sizeof(msg), "%s: %s", name, text);
-                    broadcast_message(msg);
+        }
+        else if (argv[a][0] == '-') {
+            bad_args = 1;
+        }
+        else {
+            /* A second open_room would replace the first one's FIFO. */
+            int r;
+            for (r = 0; r < num_rooms; r += 1) {
+                if (strcmp(rooms[r].name, argv[a]) == 0) {
+                    fprintf(stderr, "Room '%s' given twice\n", argv[a]);
+                    bad_args = 1;
                 }
             }
-            line = strtok_r(NULL, "\n", &save);
+            snprintf(rooms[num_rooms].name, sizeof(rooms[num_rooms].name),
+                     "%s", argv[a]);
+            num_rooms += 1;
         }
     }
-    broadcast_message("[server] shutting down...");
+    if (bad_args || num_rooms == 0) {
+        fprintf(stderr, "Usage: %s <room> [<room>...] [--threads <n>] [--shm] "
+                "[--queue-max <n>] [--slow-policy drop|disconnect]\n",
+                argv[0]);
+        return 1;
+    }
+    if (num_shards == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_shards = (cpus > 0) ? (int)cpus : 1;
+        if (num_shards > MAX_SHARDS) {
+            num_shards = MAX_SHARDS;
+        }
+    }
+    if (num_shards > num_rooms) {
+        num_shards = num_rooms;
+    }
+    /* Every FIFO member holds a descriptor; lift the soft limit. */
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        perror("eventfd");
+        return 1;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigint;
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
     int i;
-    for (i = 0; i < MAX_USERS; i += 1) {
-        if (users[i].used == 1 && users[i].fifo_fd >= 0) {
-            close(users[i].fifo_fd);
+    for (i = 0; i < num_shards; i += 1) {
+        shard_t *sh = &shards[i];
+        sh->nbuckets = 64;
+        sh->buckets  = calloc(sh->nbuckets, sizeof(user_t *));
+        sh->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (sh->buckets == NULL || sh->epoll_fd < 0) {
+            perror("shard setup");
+            return 1;
+        }
+        /* stop_fd is never read, so once signalled it wakes every shard. */
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = EPOLLIN;
+        ev.data.ptr = &stop_fd;
+        epoll_ctl(sh->epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev);
+    }
+    mkdir("fifo_files", 0777);
+    for (i = 0; i < num_rooms; i += 1) {
+        room_t *room = &rooms[i];
+        if (open_room(room, use_shm) != 0) {
+            return 1;
+        }
+        room->shard = &shards[i % num_shards];
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = EPOLLIN;
+        ev.data.ptr = room;
+        epoll_ctl(room->shard->epoll_fd, EPOLL_CTL_ADD, room->fd_read, &ev);
+        printf("[server] room '%s' ready. FIFO: %s\n",
+               room->name, room->fifo_path);
+        if (room->ring != NULL) {
+            printf("[server] shared-memory ring: %s\n", room->ring_name);
+        }
+    }
+    printf("[server] %d room(s) on %d thread(s)\n", num_rooms, num_shards);
+    fflush(stdout);
+    for (i = 0; i < num_shards; i += 1) {
+        if (pthread_create(&shards[i].thread, NULL, shard_main,
+                           &shards[i]) != 0) {
+            perror("pthread_create");
+            return 1;
         }
-        users[i].used = 0;
     }
-    if (server_fd_read >= 0) {
-        close(server_fd_read);
+    for (i = 0; i < num_shards; i += 1) {
+        (void)pthread_join(shards[i].thread, NULL);
+        close(shards[i].epoll_fd);
+        free(shards[i].buckets);
     }
-    if (server_fd_write >= 0) {
-        close(server_fd_write);
+    write_bench_json();
+    for (i = 0; i < num_rooms; i += 1) {
+        close_room(&rooms[i]);
     }
-    unlink(server_fifo_path);
+    free(rooms);
+    close(stop_fd);
     return 0;
 }
@@ -0,0 +1,110 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+/* Single-producer / multi-consumer broadcast ring in POSIX shared memory.
+ * The server publishes each message once; every same-host client keeps its
+ * own cursor and sleeps on a futex in the mapping until the head moves.
+ * A consumer that falls more than SHM_RING_SLOTS behind skips ahead. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHM_RING_MAGIC 0x43484154u
+#define SHM_RING_SLOTS 1024
+#define SHM_SLOT_DATA  2032
+
+typedef struct {
+    uint64_t seq;          /* message number + 1 once the slot is complete */
+    uint32_t len;
+    uint32_t pad;
+    char     data[SHM_SLOT_DATA];
+} shm_slot_t;
+
+typedef struct {
+    uint32_t   magic;
+    uint32_t   closed;
+    uint64_t   head;       /* messages published so far */
+    uint32_t   futex;      /* bumped on every publish */
+    uint32_t   waiters;
+    shm_slot_t slot[SHM_RING_SLOTS];
+} shm_ring_t;
+
+static inline void shm_ring_name(char *out, size_t n, const char *room) {
+    snprintf(out, n, "/chat_%s", room);
+}
+static inline void shm_ring_wake(shm_ring_t *r) {
+    __atomic_fetch_add(&r->futex, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->waiters, __ATOMIC_SEQ_CST) > 0) {
+        syscall(SYS_futex, &r->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+static inline void shm_ring_publish(shm_ring_t *r, const char *data,
+                                    size_t len) {
+    uint64_t    seq = r->head;
+    shm_slot_t *s   = &r->slot[seq % SHM_RING_SLOTS];
+    if (len > SHM_SLOT_DATA) {
+        len = SHM_SLOT_DATA;
+    }
+    /* seq 0 marks the slot as being rewritten for readers that lag. */
+    __atomic_store_n(&s->seq, 0, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    memcpy(s->data, data, len);
+    s->len = (uint32_t)len;
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->head, seq + 1, __ATOMIC_RELEASE);
+    shm_ring_wake(r);
+}
+/* Copies message *cursor into out (at least SHM_SLOT_DATA bytes) and
+ * advances the cursor. Blocks while nothing is new. Returns the length,
+ * or -1 once the ring is closed and drained. *lost counts skipped
+ * messages. */
+static inline int shm_ring_read(shm_ring_t *r, uint64_t *cursor, char *out,
+                                uint64_t *lost) {
+    while (1) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (*cursor == head) {
+            if (__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE)) {
+                return -1;
+            }
+            __atomic_fetch_add(&r->waiters, 1, __ATOMIC_SEQ_CST);
+            uint32_t f = __atomic_load_n(&r->futex, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&r->head, __ATOMIC_SEQ_CST) == *cursor &&
+                !__atomic_load_n(&r->closed, __ATOMIC_SEQ_CST)) {
+                syscall(SYS_futex, &r->futex, FUTEX_WAIT, f, NULL, NULL, 0);
+            }
+            __atomic_fetch_sub(&r->waiters, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        if (head - *cursor > SHM_RING_SLOTS) {
+            *lost += head - SHM_RING_SLOTS - *cursor;
+            *cursor = head - SHM_RING_SLOTS;
+        }
+        shm_slot_t *s = &r->slot[*cursor % SHM_RING_SLOTS];
+        if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != *cursor + 1) {
+            *lost += 1;
+            *cursor += 1;
+            continue;
+        }
+        uint32_t len = s->len;
+        if (len > SHM_SLOT_DATA) {
+            len = SHM_SLOT_DATA;
+        }
+        memcpy(out, s->data, len);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != *cursor + 1) {
+            /* Overwritten while copying. */
+            *lost += 1;
+            *cursor += 1;
+            continue;
+        }
+        *cursor += 1;
+        return (int)len;
+    }
+}
+
+#endif
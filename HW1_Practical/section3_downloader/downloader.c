@@ -6,6 +6,32 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <errno.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#define MAX_ATTEMPTS 3
+#define MAX_WORKERS  128
+
+/* A chunk fetch may take 20 s, plus one second per FETCH_MIN_RATE bytes,
+ * so large fixed-mode chunks on slow links are not cut off. */
+#define FETCH_BASE_SECS 20
+#define FETCH_MIN_RATE  (64LL << 10)
+
+/* Auto mode: start small, grow while each extra connection still buys
+ * at least AUTO_MIN_GAIN of aggregate throughput. */
+#define AUTO_START_CONNS   2
+#define AUTO_DEFAULT_MAX   16
+#define AUTO_CHUNK_MIN     (1LL << 20)
+#define AUTO_CHUNK_MAX     (4LL << 20)
+#define AUTO_TARGET_CHUNKS 256
+#define AUTO_MIN_GAIN      0.10
+#define AUTO_REPROBE_TICKS 8
+#define TICK_MS            1000
 
 typedef struct {
     long long start;
@@ -14,9 +40,263 @@ typedef struct {
     int       is_http;
     char      source[1024];
     char      part_name[64];
+    uint32_t  crc;
+    uint32_t  ref_crc;
+    int       has_ref;
+    int       done;
+    int       ok;
 } task_t;
 
+/* A pool slot. Slots are reused once their thread has exited and been
+ * joined, so MAX_WORKERS bounds concurrent connections only. */
+typedef struct {
+    pthread_t thread;
+    int       id;
+    int       used;
+    int       exited;
+    int       retire;
+    long long bytes;
+    double    t_start;
+    double    t_end;
+} worker_t;
+
+/* Totals of a joined connection, kept for the bench report. */
+typedef struct {
+    int       id;
+    long long bytes;
+    double    seconds;
+} conn_stat_t;
+
+typedef struct {
+    uint32_t      state[8];
+    uint64_t      length;
+    unsigned char block[64];
+    size_t        used;
+} sha256_t;
+
 static int DEBUG_LOG = 0;
+static pthread_mutex_t done_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  done_cv    = PTHREAD_COND_INITIALIZER;
+
+/* Chunk queue and worker pool, all guarded by done_mutex. */
+static task_t   *tasks       = NULL;
+static int       num_chunks  = 0;
+static int       next_chunk  = 0;
+static int       chunks_done = 0;
+static worker_t  workers[MAX_WORKERS];
+static int       total_spawned = 0;
+static int       live_workers = 0;
+static conn_stat_t *conn_log  = NULL;
+static int       conn_log_len = 0;
+static int       conn_log_cap = 0;
+static long long total_bytes = 0;
+static long long total_size  = -1;
+static int       auto_mode   = 0;
+static int       max_conns   = AUTO_DEFAULT_MAX;
+
+/* CRC32C (Castagnoli), reflected polynomial. */
+#define CRC32C_POLY 0x82F63B78u
+static uint32_t crc32c_table[256];
+static int      crc32c_hw = 0;
+
+static void crc32c_init(void) {
+    uint32_t i;
+    for (i = 0; i < 256; i += 1) {
+        uint32_t c = i;
+        int k;
+        for (k = 0; k < 8; k += 1) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : (c >> 1);
+        }
+        crc32c_table[i] = c;
+    }
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    crc32c_hw = __builtin_cpu_supports("sse4.2");
+#endif
+}
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t n) {
+    while (n > 0) {
+        crc = crc32c_table[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+        p += 1;
+        n -= 1;
+    }
+    return crc;
+}
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t n) {
+    uint64_t c = crc;
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        n -= 8;
+    }
+    crc = (uint32_t)c;
+    while (n > 0) {
+        crc = _mm_crc32_u8(crc, *p);
+        p += 1;
+        n -= 1;
+    }
+    return crc;
+}
+#endif
+static uint32_t crc32c_update(uint32_t crc, const void *buf, size_t n) {
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (crc32c_hw) {
+        return ~crc32c_sse42(crc, (const unsigned char *)buf, n);
+    }
+#endif
+    return ~crc32c_sw(crc, (const unsigned char *)buf, n);
+}
+/* GF(2) matrix helpers for crc32c_combine (same scheme as zlib). */
+static uint32_t gf2_times(const uint32_t *mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec != 0) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat += 1;
+    }
+    return sum;
+}
+static void gf2_square(uint32_t *square, const uint32_t *mat) {
+    int n;
+    for (n = 0; n < 32; n += 1) {
+        square[n] = gf2_times(mat, mat[n]);
+    }
+}
+/* CRC of A||B from crc(A), crc(B) and len(B), without touching the data. */
+static uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, long long len2) {
+    uint32_t even[32];
+    uint32_t odd[32];
+    uint32_t row = 1;
+    int n;
+    if (len2 <= 0) {
+        return crc1;
+    }
+    odd[0] = CRC32C_POLY;
+    for (n = 1; n < 32; n += 1) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2_square(even, odd);
+    gf2_square(odd, even);
+    do {
+        gf2_square(even, odd);
+        if (len2 & 1) {
+            crc1 = gf2_times(even, crc1);
+        }
+        len2 >>= 1;
+        if (len2 == 0) {
+            break;
+        }
+        gf2_square(odd, even);
+        if (len2 & 1) {
+            crc1 = gf2_times(odd, crc1);
+        }
+        len2 >>= 1;
+    } while (len2 != 0);
+    return crc1 ^ crc2;
+}
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(sha256_t *ctx, const unsigned char *p) {
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    int i;
+    for (i = 0; i < 16; i += 1) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+               ((uint32_t)p[4 * i + 2] << 8) | (uint32_t)p[4 * i + 3];
+    }
+    for (i = 16; i < 64; i += 1) {
+        uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    a = ctx->state[0]; b = ctx->state[1]; c = ctx->state[2]; d = ctx->state[3];
+    e = ctx->state[4]; f = ctx->state[5]; g = ctx->state[6]; h = ctx->state[7];
+    for (i = 0; i < 64; i += 1) {
+        uint32_t s1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
+        uint32_t mj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + mj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c; ctx->state[3] += d;
+    ctx->state[4] += e; ctx->state[5] += f; ctx->state[6] += g; ctx->state[7] += h;
+}
+static void sha256_init(sha256_t *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+static void sha256_update(sha256_t *ctx, const void *buf, size_t n) {
+    const unsigned char *p = (const unsigned char *)buf;
+    ctx->length += n;
+    if (ctx->used > 0) {
+        size_t take = 64 - ctx->used;
+        if (take > n) {
+            take = n;
+        }
+        memcpy(ctx->block + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        n -= take;
+        if (ctx->used < 64) {
+            return;
+        }
+        sha256_block(ctx, ctx->block);
+        ctx->used = 0;
+    }
+    while (n >= 64) {
+        sha256_block(ctx, p);
+        p += 64;
+        n -= 64;
+    }
+    memcpy(ctx->block, p, n);
+    ctx->used = n;
+}
+static void sha256_final(sha256_t *ctx, char hex[65]) {
+    uint64_t bits = ctx->length * 8;
+    unsigned char pad[72];
+    size_t pad_len = (ctx->used < 56) ? 56 - ctx->used : 120 - ctx->used;
+    int i;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (i = 0; i < 8; i += 1) {
+        pad[pad_len + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha256_update(ctx, pad, pad_len + 8);
+    for (i = 0; i < 8; i += 1) {
+        snprintf(hex + 8 * i, 9, "%08x", ctx->state[i]);
+    }
+}
+
 static long long get_local_size(const char *path) {
     struct stat st;
     int ok = stat(path, &st);
@@ -93,76 +373,435 @@ static const char *base_name(const char *s) {
     }
     return s;
 }
-static void *worker_func(void *arg) {
-    task_t *task = (task_t *)arg;
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+/* Fetches one attempt of a chunk into its part file, hashing as it writes. */
+static int fetch_chunk(worker_t *self, task_t *task) {
+    long long expected = task->end - task->start + 1;
+    long long got = 0;
+    int in_fd = -1;
+    FILE *pipe = NULL;
+    int ok = 1;
     if (task->is_http == 1) {
         char command[2048];
-        printf("[Thread %d] Downloading bytes %lld-%lld\n",
-               task->index + 1, task->start, task->end);
-        fflush(stdout);
         snprintf(command, sizeof(command),
-                 "curl -sS --fail -L --connect-timeout 5 --max-time 20 --insecure "
-                 "--range %lld-%lld -o \"%s\" \"%s\"",
-                 task->start, task->end,
-                 task->part_name, task->source);
+                 "curl -sS --fail -L --connect-timeout 5 --max-time %lld --insecure "
+                 "--range %lld-%lld -o - \"%s\"",
+                 FETCH_BASE_SECS + expected / FETCH_MIN_RATE,
+                 task->start, task->end, task->source);
         if (DEBUG_LOG) {
             fprintf(stderr, "[DBG] %s\n", command);
         }
-        (void)system(command);
+        pipe = popen(command, "r");
+        if (pipe == NULL) {
+            perror("popen curl");
+            return 0;
+        }
+        in_fd = fileno(pipe);
     }
     else {
-        int in_fd = open(task->source, O_RDONLY);
+        in_fd = open(task->source, O_RDONLY);
         if (in_fd < 0) {
             perror("open source");
-            return NULL;
-        }
-        int out_fd = open(task->part_name, O_CREAT | O_TRUNC | O_WRONLY, 0666);
-        if (out_fd < 0) {
-            perror("open part");
-            close(in_fd);
-            return NULL;
+            return 0;
         }
         if (lseek(in_fd, task->start, SEEK_SET) == (off_t)-1) {
             perror("lseek");
+            close(in_fd);
+            return 0;
         }
-        long long remaining = task->end - task->start + 1;
-        char buf[1 << 16];
-        while (remaining > 0) {
-            size_t chunk = sizeof(buf);
-            if ((long long)chunk > remaining) {
-                chunk = (size_t)remaining;
-            }
-            ssize_t r = read(in_fd, buf, chunk);
-            if (r <= 0) {
-                break;
-            }
-            ssize_t w = write(out_fd, buf, r);
-            if (w != r) {
-                perror("write");
-                break;
-            }
-            remaining -= r;
+    }
+    int out_fd = open(task->part_name, O_CREAT | O_TRUNC | O_WRONLY, 0666);
+    if (out_fd < 0) {
+        perror("open part");
+        ok = 0;
+    }
+    task->crc = 0;
+    char buf[1 << 16];
+    while (ok && got < expected) {
+        size_t chunk = sizeof(buf);
+        if ((long long)chunk > expected - got) {
+            chunk = (size_t)(expected - got);
         }
-        close(in_fd);
+        ssize_t r = read(in_fd, buf, chunk);
+        if (r <= 0) {
+            break;
+        }
+        ssize_t w = write(out_fd, buf, r);
+        if (w != r) {
+            perror("write");
+            ok = 0;
+            break;
+        }
+        task->crc = crc32c_update(task->crc, buf, (size_t)r);
+        got += r;
+        __atomic_fetch_add(&self->bytes, r, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&total_bytes, r, __ATOMIC_RELAXED);
+    }
+    if (out_fd >= 0) {
         close(out_fd);
+    }
+    if (pipe != NULL) {
+        int st = pclose(pipe);
+        if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+            ok = 0;
+        }
+    }
+    else {
+        close(in_fd);
+    }
+    return ok && got == expected;
+}
+static void run_task(worker_t *self, task_t *task) {
+    int ok = 0;
+    int attempt;
+    if (task->is_http == 1) {
+        printf("[Thread %d] Downloading bytes %lld-%lld\n",
+               self->id + 1, task->start, task->end);
+        fflush(stdout);
+    }
+    for (attempt = 1; attempt <= MAX_ATTEMPTS && !ok; attempt += 1) {
+        if (attempt > 1) {
+            printf("[Thread %d] Retrying bytes %lld-%lld (attempt %d)\n",
+                   self->id + 1, task->start, task->end, attempt);
+            fflush(stdout);
+        }
+        ok = fetch_chunk(self, task);
+        if (ok && task->has_ref && task->crc != task->ref_crc) {
+            fprintf(stderr, "[Thread %d] CRC32C mismatch on bytes %lld-%lld: "
+                    "got %08x, expected %08x\n", self->id + 1, task->start,
+                    task->end, task->crc, task->ref_crc);
+            ok = 0;
+        }
+    }
+    if (ok && task->is_http == 0) {
         printf("[Thread %d] Copied bytes %lld-%lld\n",
-               task->index + 1, task->start, task->end);
+               self->id + 1, task->start, task->end);
+        fflush(stdout);
+    }
+    if (!ok) {
+        fprintf(stderr, "[Thread %d] Giving up on bytes %lld-%lld\n",
+                self->id + 1, task->start, task->end);
+    }
+    pthread_mutex_lock(&done_mutex);
+    task->ok = ok;
+    task->done = 1;
+    chunks_done += 1;
+    pthread_cond_broadcast(&done_cv);
+    pthread_mutex_unlock(&done_mutex);
+}
+static void *worker_func(void *arg) {
+    worker_t *self = (worker_t *)arg;
+    self->t_start = now_sec();
+    while (1) {
+        pthread_mutex_lock(&done_mutex);
+        if (self->retire || next_chunk >= num_chunks) {
+            pthread_mutex_unlock(&done_mutex);
+            break;
+        }
+        task_t *task = &tasks[next_chunk];
+        next_chunk += 1;
+        pthread_mutex_unlock(&done_mutex);
+        run_task(self, task);
+    }
+    pthread_mutex_lock(&done_mutex);
+    self->t_end  = now_sec();
+    self->exited = 1;
+    pthread_cond_broadcast(&done_cv);
+    pthread_mutex_unlock(&done_mutex);
+    return NULL;
+}
+/* Called with done_mutex held. Joins every worker that has exited, logs
+ * its totals and frees its slot. The threads no longer need the mutex,
+ * so the joins return promptly. */
+static void reap_workers(void) {
+    int i;
+    for (i = 0; i < MAX_WORKERS; i += 1) {
+        worker_t *w = &workers[i];
+        if (!w->used || !w->exited) {
+            continue;
+        }
+        (void)pthread_join(w->thread, NULL);
+        if (conn_log_len == conn_log_cap) {
+            int cap = conn_log_cap ? conn_log_cap * 2 : 32;
+            conn_stat_t *log = realloc(conn_log, cap * sizeof(conn_stat_t));
+            if (log != NULL) {
+                conn_log     = log;
+                conn_log_cap = cap;
+            }
+        }
+        if (conn_log_len < conn_log_cap) {
+            conn_log[conn_log_len].id      = w->id;
+            conn_log[conn_log_len].bytes   = w->bytes;
+            conn_log[conn_log_len].seconds = w->t_end - w->t_start;
+            conn_log_len += 1;
+        }
+        w->used = 0;
+    }
+}
+/* Called with done_mutex held. */
+static int spawn_worker(void) {
+    reap_workers();
+    worker_t *w = NULL;
+    int i;
+    for (i = 0; i < MAX_WORKERS && w == NULL; i += 1) {
+        if (!workers[i].used) {
+            w = &workers[i];
+        }
+    }
+    if (w == NULL) {
+        return 0;
+    }
+    w->id     = total_spawned;
+    w->exited = 0;
+    w->retire = 0;
+    w->bytes  = 0;
+    if (pthread_create(&w->thread, NULL, worker_func, w) != 0) {
+        perror("pthread_create");
+        return 0;
+    }
+    w->used = 1;
+    total_spawned += 1;
+    live_workers += 1;
+    return 1;
+}
+/* Called with done_mutex held: the newest live worker finishes its
+ * current chunk and exits. */
+static void retire_worker(void) {
+    worker_t *newest = NULL;
+    int i;
+    for (i = 0; i < MAX_WORKERS; i += 1) {
+        worker_t *w = &workers[i];
+        if (w->used && !w->retire && (newest == NULL || w->id > newest->id)) {
+            newest = w;
+        }
+    }
+    if (newest != NULL) {
+        newest->retire = 1;
+        live_workers -= 1;
+    }
+}
+/* Prints progress once per tick and, in auto mode, hill-climbs the
+ * connection count on measured aggregate throughput. */
+static void *monitor_func(void *arg) {
+    (void)arg;
+    long long last_total = 0;
+    long long last_bytes[MAX_WORKERS];
+    int       last_id[MAX_WORKERS];
+    double    last_time = now_sec();
+    double    base_rate = 0.0;
+    int       probing   = auto_mode;
+    int       settled   = 0;
+    memset(last_bytes, 0, sizeof(last_bytes));
+    memset(last_id, -1, sizeof(last_id));
+    pthread_mutex_lock(&done_mutex);
+    while (chunks_done < num_chunks) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += TICK_MS / 1000;
+        deadline.tv_nsec += (TICK_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        int rc = 0;
+        while (chunks_done < num_chunks && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&done_cv, &done_mutex, &deadline);
+        }
+        if (chunks_done >= num_chunks) {
+            break;
+        }
+        double    t    = now_sec();
+        long long cur  = __atomic_load_n(&total_bytes, __ATOMIC_RELAXED);
+        double    rate = (cur - last_total) / (t - last_time);
+        int i;
+        printf("[Progress] %.1f/%.1f MiB (%.0f%%), %.2f MiB/s, %d conns\n",
+               cur / 1048576.0, total_size / 1048576.0,
+               total_size > 0 ? 100.0 * cur / total_size : 0.0,
+               rate / 1048576.0, live_workers);
         fflush(stdout);
+        reap_workers();
+        for (i = 0; i < MAX_WORKERS; i += 1) {
+            if (!workers[i].used) {
+                continue;
+            }
+            if (workers[i].id != last_id[i]) {
+                last_id[i]    = workers[i].id;
+                last_bytes[i] = 0;
+            }
+            long long b = __atomic_load_n(&workers[i].bytes, __ATOMIC_RELAXED);
+            if (DEBUG_LOG && !workers[i].retire) {
+                fprintf(stderr, "[DBG] conn %d: %.2f MiB/s\n",
+                        workers[i].id + 1,
+                        (b - last_bytes[i]) / (t - last_time) / 1048576.0);
+            }
+            last_bytes[i] = b;
+        }
+        last_total = cur;
+        last_time  = t;
+        if (!auto_mode || next_chunk >= num_chunks) {
+            continue;
+        }
+        if (probing) {
+            /* The last connection we added must pay for itself. */
+            if (live_workers > 1 && rate < base_rate * (1.0 + AUTO_MIN_GAIN)) {
+                retire_worker();
+                probing = 0;
+                settled = 0;
+            }
+            else if (live_workers < max_conns && spawn_worker()) {
+                base_rate = rate;
+            }
+            else {
+                probing = 0;
+                settled = 0;
+            }
+        }
+        else {
+            /* Re-probe now and then in case the link got faster. */
+            settled += 1;
+            if (settled >= AUTO_REPROBE_TICKS && live_workers < max_conns &&
+                spawn_worker()) {
+                base_rate = rate;
+                probing = 1;
+            }
+        }
     }
+    pthread_mutex_unlock(&done_mutex);
     return NULL;
 }
+/* Reads a per-chunk CRC32C manifest: a "block <bytes>" line followed by
+ * one hex CRC32C per block, in file order. Returns the CRC count, or -1. */
+static int load_chunk_manifest(const char *path, long long *block,
+                               uint32_t **crcs) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    int n = 0;
+    int cap = 0;
+    *crcs = NULL;
+    if (fscanf(f, " block %lld", block) != 1 || *block <= 0) {
+        fprintf(stderr, "%s: expected a 'block <bytes>' line\n", path);
+        fclose(f);
+        return -1;
+    }
+    unsigned int v;
+    while (fscanf(f, " %8x", &v) == 1) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 256;
+            uint32_t *c = realloc(*crcs, cap * sizeof(uint32_t));
+            if (c == NULL) {
+                perror("realloc");
+                fclose(f);
+                return -1;
+            }
+            *crcs = c;
+        }
+        (*crcs)[n] = v;
+        n += 1;
+    }
+    int bad = !feof(f);
+    fclose(f);
+    if (bad) {
+        fprintf(stderr, "%s: bad CRC32C entry after %d blocks\n", path, n);
+        return -1;
+    }
+    return n;
+}
+/* Called with done_mutex held: marks every chunk not yet handed out as
+ * failed, so workers stop and the merge loop does not wait for them. */
+static void cancel_pending_chunks(void) {
+    while (next_chunk < num_chunks) {
+        tasks[next_chunk].done = 1;
+        tasks[next_chunk].ok   = 0;
+        chunks_done += 1;
+        next_chunk  += 1;
+    }
+    pthread_cond_broadcast(&done_cv);
+}
+/* Appends one JSON line with per-connection throughput when BENCH_JSON
+ * is set. Expects every worker to have been reaped into conn_log. */
+static void write_bench_json(double elapsed) {
+    const char *json_path = getenv("BENCH_JSON");
+    if (json_path == NULL) {
+        return;
+    }
+    FILE *jf = fopen(json_path, "a");
+    if (jf == NULL) {
+        return;
+    }
+    fprintf(jf, "{\"tool\":\"downloader\",\"mode\":\"%s\","
+            "\"size\":%lld,\"chunks\":%d,\"elapsed_s\":%.6f,"
+            "\"bytes_per_s\":%.1f,\"workers\":[",
+            auto_mode ? "auto" : "fixed", total_size, num_chunks, elapsed,
+            elapsed > 0 ? total_bytes / elapsed : 0.0);
+    int i;
+    for (i = 0; i < conn_log_len; i += 1) {
+        const conn_stat_t *c = &conn_log[i];
+        fprintf(jf, "%s{\"id\":%d,\"bytes\":%lld,\"seconds\":%.6f,"
+                "\"bytes_per_s\":%.1f}", i > 0 ? "," : "", c->id + 1,
+                c->bytes, c->seconds,
+                c->seconds > 0 ? c->bytes / c->seconds : 0.0);
+    }
+    fprintf(jf, "]}\n");
+    fclose(jf);
+}
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <url_or_path> <num_threads>\n", argv[0]);
+    const char *want_crc32c = NULL;
+    const char *want_sha256 = NULL;
+    const char *chunk_manifest = NULL;
+    int bad_args = (argc < 3);
+    int a;
+    for (a = 3; a < argc && !bad_args; a += 1) {
+        if (strcmp(argv[a], "--crc32c") == 0 && a + 1 < argc) {
+            a += 1;
+            want_crc32c = argv[a];
+        }
+        else if (strcmp(argv[a], "--chunk-crc32c") == 0 && a + 1 < argc) {
+            a += 1;
+            chunk_manifest = argv[a];
+        }
+        else if (strcmp(argv[a], "--sha256") == 0 && a + 1 < argc) {
+            a += 1;
+            want_sha256 = argv[a];
+        }
+        else if (strcmp(argv[a], "--max-conns") == 0 && a + 1 < argc) {
+            a += 1;
+            max_conns = atoi(argv[a]);
+        }
+        else {
+            bad_args = 1;
+        }
+    }
+    if (bad_args) {
+        fprintf(stderr, "Usage: %s <url_or_path> <num_threads|auto> "
+                "[--max-conns <n>] [--crc32c <hex>] [--sha256 <hex>] "
+                "[--chunk-crc32c <manifest>]\n",
+                argv[0]);
         return 1;
     }
+    crc32c_init();
     const char *source = argv[1];
     int num_threads = atoi(argv[2]);
+    if (strcmp(argv[2], "auto") == 0) {
+        auto_mode = 1;
+    }
     if (num_threads <= 0) {
         num_threads = 1;
     }
-    if (num_threads > 128) {
-        num_threads = 128;
+    if (num_threads > MAX_WORKERS) {
+        num_threads = MAX_WORKERS;
+    }
+    if (max_conns <= 0) {
+        max_conns = 1;
+    }
+    if (max_conns > MAX_WORKERS) {
+        max_conns = MAX_WORKERS;
     }
     if (getenv("DOWN_DEBUG") != NULL) {
         DEBUG_LOG = 1;
@@ -172,26 +811,33 @@ int main(int argc, char **argv) {
         strncmp(source, "https://", 8) == 0) {
         is_http = 1;
     }
-    long long total_size = -1;
     if (is_http == 1) {
         total_size = get_http_size(source);
         if (total_size <= 0) {
             const char *base = base_name(source);
             char dest[256];
             snprintf(dest, sizeof(dest), "%s", (*base) ? base : "download.bin");
+            char tmp_path[300];
+            snprintf(tmp_path, sizeof(tmp_path), "%s.part", dest);
             char command[2048];
             printf("[Info] Unknown Content-Length -> single-thread download to %s\n",
                    dest);
             snprintf(command, sizeof(command),
                      "curl -sS -L --connect-timeout 5 --max-time 120 --insecure "
-                     "-o \"%s\" \"%s\"",
-                     dest, source);
+                     "--fail -o \"%s\" \"%s\"",
+                     tmp_path, source);
             if (DEBUG_LOG) {
                 fprintf(stderr, "[DBG] %s\n", command);
             }
             int rc = system(command);
             if (rc != 0) {
                 fprintf(stderr, "curl failed (rc=%d)\n", rc);
+                unlink(tmp_path);
+                return 1;
+            }
+            if (rename(tmp_path, dest) != 0) {
+                perror("rename");
+                unlink(tmp_path);
                 return 1;
             }
             printf("Download complete: %s\n", dest);
@@ -208,15 +854,60 @@ int main(int argc, char **argv) {
     const char *base = base_name(source);
     char dest[256];
     snprintf(dest, sizeof(dest), "%s", (*base) ? base : "download.bin");
-    long long part_size = total_size / num_threads;
-    long long remainder = total_size % num_threads;
-    pthread_t *threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
-    task_t    *tasks   = (task_t *)calloc(num_threads, sizeof(task_t));
+    /* The file is assembled under a temporary name and only renamed once
+     * every chunk and digest checks out. */
+    char tmp_path[300];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.part", dest);
+    long long block = 0;
+    uint32_t *ref_crcs = NULL;
+    int num_refs = 0;
+    if (chunk_manifest != NULL) {
+        num_refs = load_chunk_manifest(chunk_manifest, &block, &ref_crcs);
+        if (num_refs < 0) {
+            return 1;
+        }
+        if (num_refs != (total_size + block - 1) / block) {
+            fprintf(stderr, "%s: %d blocks listed, %lld expected for "
+                    "%lld bytes\n", chunk_manifest, num_refs,
+                    (total_size + block - 1) / block, total_size);
+            return 1;
+        }
+    }
+    /* Fixed mode keeps one chunk per thread; auto mode cuts smaller chunks
+     * so connections can be added or retired between them. A manifest
+     * dictates the chunks so each one has a reference CRC. */
+    num_chunks = num_threads;
+    if (auto_mode) {
+        /* About AUTO_TARGET_CHUNKS chunks, each 1-4 MiB, so one chunk
+         * stays short even on a slow link and a retired connection is
+         * gone quickly. Big files get more chunks rather than bigger. */
+        long long want = (total_size + AUTO_CHUNK_MIN - 1) / AUTO_CHUNK_MIN;
+        long long least = (total_size + AUTO_CHUNK_MAX - 1) / AUTO_CHUNK_MAX;
+        if (want > AUTO_TARGET_CHUNKS) {
+            want = (least > AUTO_TARGET_CHUNKS) ? least : AUTO_TARGET_CHUNKS;
+        }
+        num_chunks = (int)want;
+    }
+    if (num_refs > 0) {
+        num_chunks = num_refs;
+    }
+    if (num_chunks > total_size) {
+        num_chunks = (int)total_size;
+    }
+    long long part_size = total_size / num_chunks;
+    long long remainder = total_size % num_chunks;
+    tasks = (task_t *)calloc(num_chunks, sizeof(task_t));
     int i;
-    for (i = 0; i < num_threads; i += 1) {
+    for (i = 0; i < num_chunks; i += 1) {
         long long start = i * part_size + (i < remainder ? i : remainder);
         long long end   = start + part_size - 1 + (i < remainder ? 1 : 0);
-        if (i == num_threads - 1) {
+        if (num_refs > 0) {
+            start = i * block;
+            end   = start + block - 1;
+            tasks[i].ref_crc = ref_crcs[i];
+            tasks[i].has_ref = 1;
+        }
+        if (i == num_chunks - 1) {
             end = total_size - 1;
         }
         tasks[i].start   = start;
@@ -226,25 +917,62 @@ int main(int argc, char **argv) {
         snprintf(tasks[i].source, sizeof(tasks[i].source), "%s", source);
         snprintf(tasks[i].part_name, sizeof(tasks[i].part_name),
                  "part_%d.bin", i);
-        if (pthread_create(&threads[i], NULL, worker_func, &tasks[i]) != 0) {
-            perror("pthread_create");
-            return 1;
+    }
+    double t_begin = now_sec();
+    int initial = auto_mode ? AUTO_START_CONNS : num_threads;
+    if (initial > max_conns && auto_mode) {
+        initial = max_conns;
+    }
+    pthread_mutex_lock(&done_mutex);
+    for (i = 0; i < initial; i += 1) {
+        if (!spawn_worker()) {
+            break;
         }
     }
-    for (i = 0; i < num_threads; i += 1) {
-        (void)pthread_join(threads[i], NULL);
+    pthread_mutex_unlock(&done_mutex);
+    if (total_spawned == 0) {
+        return 1;
+    }
+    pthread_t monitor;
+    if (pthread_create(&monitor, NULL, monitor_func, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
     }
-    FILE *out = fopen(dest, "wb");
+    FILE *out = fopen(tmp_path, "wb");
     if (out == NULL) {
         perror("fopen dest");
         return 1;
     }
-    for (i = 0; i < num_threads; i += 1) {
-        char part_name[64];
-        snprintf(part_name, sizeof(part_name), "part_%d.bin", i);
-        FILE *in = fopen(part_name, "rb");
+    printf("Merging parts...\n");
+    /* Merge parts in order as soon as each one completes; the SHA-256 is
+     * fed from the merge stream, so verification costs no extra read. */
+    sha256_t sha;
+    sha256_init(&sha);
+    uint32_t crc = 0;
+    int failed = 0;
+    for (i = 0; i < num_chunks; i += 1) {
+        pthread_mutex_lock(&done_mutex);
+        while (!tasks[i].done) {
+            pthread_cond_wait(&done_cv, &done_mutex);
+        }
+        if (!tasks[i].ok) {
+            failed = 1;
+        }
+        if (failed) {
+            /* Nothing after a hole can be placed; stop fetching. */
+            cancel_pending_chunks();
+        }
+        pthread_mutex_unlock(&done_mutex);
+        if (failed) {
+            remove(tasks[i].part_name);
+            continue;
+        }
+        crc = crc32c_combine(crc, tasks[i].crc,
+                             tasks[i].end - tasks[i].start + 1);
+        FILE *in = fopen(tasks[i].part_name, "rb");
         if (in == NULL) {
             perror("fopen part");
+            failed = 1;
             continue;
         }
         char buf[1 << 16];
@@ -253,14 +981,66 @@ int main(int argc, char **argv) {
             size_t w = fwrite(buf, 1, r, out);
             if (w != r) {
                 perror("fwrite");
+                failed = 1;
                 break;
             }
+            if (want_sha256 != NULL) {
+                sha256_update(&sha, buf, r);
+            }
         }
         fclose(in);
-        remove(part_name);
+        remove(tasks[i].part_name);
+    }
+    (void)pthread_join(monitor, NULL);
+    /* Every chunk is done, so the remaining workers are on their way out. */
+    pthread_mutex_lock(&done_mutex);
+    for (i = 0; i < MAX_WORKERS; i += 1) {
+        while (workers[i].used && !workers[i].exited) {
+            pthread_cond_wait(&done_cv, &done_mutex);
+        }
+    }
+    reap_workers();
+    pthread_mutex_unlock(&done_mutex);
+    write_bench_json(now_sec() - t_begin);
+    if (fclose(out) != 0) {
+        perror("fclose dest");
+        failed = 1;
+    }
+    free(tasks);
+    free(conn_log);
+    free(ref_crcs);
+    if (failed) {
+        fprintf(stderr, "Download incomplete: %s\n", dest);
+        unlink(tmp_path);
+        return 1;
+    }
+    if (want_crc32c != NULL) {
+        char hex[9];
+        snprintf(hex, sizeof(hex), "%08x", crc);
+        if (strcasecmp(hex, want_crc32c) != 0) {
+            fprintf(stderr, "CRC32C mismatch: got %s, expected %s\n",
+                    hex, want_crc32c);
+            unlink(tmp_path);
+            return 2;
+        }
+        printf("CRC32C OK: %s\n", hex);
+    }
+    if (want_sha256 != NULL) {
+        char hex[65];
+        sha256_final(&sha, hex);
+        if (strcasecmp(hex, want_sha256) != 0) {
+            fprintf(stderr, "SHA-256 mismatch: got %s, expected %s\n",
+                    hex, want_sha256);
+            unlink(tmp_path);
+            return 2;
+        }
+        printf("SHA-256 OK: %s\n", hex);
+    }
+    if (rename(tmp_path, dest) != 0) {
+        perror("rename");
+        unlink(tmp_path);
+        return 1;
     }
-    fclose(out);
-    printf("Merging parts...\n");
     printf("Download complete: %s\n", dest);
     return 0;
 }
\ No newline at end of file
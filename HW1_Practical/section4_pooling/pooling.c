@@ -4,6 +4,7 @@
 #include <sys/mman.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <time.h>
 
 #define MAX 100
 
@@ -16,7 +17,13 @@ static int clamp(int v, int lo, int hi) {
     }
     return v;
 }
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 int main(void) {
+    double t_start = now_sec();
     int M, N, K, L;
     if (scanf("%d %d %d %d", &M, &N, &K, &L) != 4) {
         fprintf(stderr, "Need M N K L\n");
@@ -46,6 +53,7 @@ int main(void) {
             }
         }
     }
+    double t_read = now_sec();
     for (i = 0; i < M; i += 1) {
         pid_t pid = fork();
         if (pid < 0) {
@@ -86,6 +94,7 @@ int main(void) {
         int st = 0;
         (void)wait(&st);
     }
+    double t_compute = now_sec();
     for (i = 0; i < M; i += 1) {
         for (j = 0; j < N; j += 1) {
             if (j > 0) {
@@ -95,5 +104,20 @@ int main(void) {
         }
         printf("\n");
     }
+    fflush(stdout);
+    double t_output = now_sec();
+    const char *json_path = getenv("BENCH_JSON");
+    if (json_path != NULL) {
+        FILE *jf = fopen(json_path, "a");
+        if (jf != NULL) {
+            fprintf(jf, "{\"tool\":\"pooling\",\"M\":%d,\"N\":%d,"
+                    "\"K\":%d,\"L\":%d,\"read_s\":%.6f,"
+                    "\"compute_s\":%.6f,\"output_s\":%.6f,"
+                    "\"total_s\":%.6f}\n",
+                    M, N, K, L, t_read - t_start, t_compute - t_read,
+                    t_output - t_compute, t_output - t_start);
+            fclose(jf);
+        }
+    }
     return 0;
 }